@@ -321,6 +321,81 @@ Container languageCultures() {
 	};
 }
 
+template<class Container>
+Container languageScripts() {
+	return Container{
+		// {tesseract language, script as reported by the orientation and script detection}
+		// Languages which are not listed are written in the Latin script
+		{"amh", "Ethiopic"},
+		{"ara", "Arabic"},
+		{"asm", "Bengali"},
+		{"aze_cyrl", "Cyrillic"},
+		{"bel", "Cyrillic"},
+		{"ben", "Bengali"},
+		{"bod", "Tibetan"},
+		{"bul", "Cyrillic"},
+		{"chi_sim", "Han"},
+		{"chi_sim_vert", "Han"},
+		{"chi_tra", "Han"},
+		{"chi_tra_vert", "Han"},
+		{"chr", "Cherokee"},
+		{"dan_frak", "Fraktur"},
+		{"deu_frak", "Fraktur"},
+		{"div", "Thaana"},
+		{"dzo", "Tibetan"},
+		{"ell", "Greek"},
+		{"fas", "Arabic"},
+		{"grc", "Greek"},
+		{"guj", "Gujarati"},
+		{"heb", "Hebrew"},
+		{"hin", "Devanagari"},
+		{"hye", "Armenian"},
+		{"iku", "Canadian_Aboriginal"},
+		{"jpn", "Japanese"},
+		{"jpn", "Han"},
+		{"jpn_vert", "Japanese"},
+		{"jpn_vert", "Han"},
+		{"kan", "Kannada"},
+		{"kat", "Georgian"},
+		{"kat_old", "Georgian"},
+		{"kaz", "Cyrillic"},
+		{"khm", "Khmer"},
+		{"kir", "Cyrillic"},
+		{"kor", "Korean"},
+		{"kor", "Hangul"},
+		{"kor_vert", "Korean"},
+		{"kor_vert", "Hangul"},
+		{"lao", "Lao"},
+		{"mal", "Malayalam"},
+		{"mar", "Devanagari"},
+		{"mkd", "Cyrillic"},
+		{"mon", "Cyrillic"},
+		{"mya", "Myanmar"},
+		{"nep", "Devanagari"},
+		{"ori", "Oriya"},
+		{"pan", "Gurmukhi"},
+		{"pus", "Arabic"},
+		{"rus", "Cyrillic"},
+		{"san", "Devanagari"},
+		{"sin", "Sinhala"},
+		{"slk_frak", "Fraktur"},
+		{"snd", "Arabic"},
+		{"srp", "Cyrillic"},
+		{"syr", "Syriac"},
+		{"tam", "Tamil"},
+		{"tat", "Cyrillic"},
+		{"tel", "Telugu"},
+		{"tgk", "Cyrillic"},
+		{"tha", "Thai"},
+		{"tir", "Ethiopic"},
+		{"uig", "Arabic"},
+		{"ukr", "Cyrillic"},
+		{"urd", "Arabic"},
+		{"uzb_cyrl", "Cyrillic"},
+		{"yid", "Hebrew"},
+	};
+}
+
 }
 
 #endif // LANGTABLES_HH
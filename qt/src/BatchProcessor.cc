@@ -0,0 +1,443 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * BatchProcessor.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QDirIterator>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSettings>
+#include <QThread>
+#include <QtSpell.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#include <tesseract/strngs.h>
+#include <tesseract/genericvector.h>
+#undef USE_STD_NAMESPACE
+
+#include "BatchProcessor.hh"
+#include "Config.hh"
+#include "DisplayRenderer.hh"
+#include "HOCRDocument.hh"
+#include "HOCRPdfExporter.hh"
+#include "OutputEditor.hh"
+#include "RecognitionPipeline.hh"
+#include "RecognitionProfile.hh"
+#include "common.hh"
+#include "Utils.hh"
+
+// Collects the results of the pages of a file, to write them once all pages are recognized
+class BatchProcessor::Output : public RecognitionPipeline::Output {
+public:
+	Output(OutputEditor::ResultFormat format, int nPages) : m_format(format), m_pages(nPages) {}
+	OutputEditor::ResultFormat resultFormat() const override {
+		return m_format;
+	}
+	QString formatId() const override {
+		// Shares the cached results with the output editor of the same format
+		return m_format == OutputEditor::ResultFormat::HOCR ? "OutputEditorHOCR" : "OutputEditorText";
+	}
+	void readResult(const QString& result, const OutputEditor::ReadSessionData& data) override {
+		Page& page = m_pages[data.page - 1];
+		page.result = result.isNull() ? QString("") : result;
+		page.angle = data.angle;
+		page.resolution = data.resolution;
+	}
+	void readError(const QString& /*errorMsg*/, const OutputEditor::ReadSessionData& data) override {
+		m_pages[data.page - 1].result = QString();
+	}
+	const QList<Page>& pages() const {
+		return m_pages;
+	}
+
+private:
+	OutputEditor::ResultFormat m_format;
+	QList<Page> m_pages;
+};
+
+bool BatchProcessor::isBatchCommand(int argc, char* argv[]) {
+	return argc >= 2 && std::strcmp("batch", argv[1]) == 0;
+}
+
+int BatchProcessor::run(const QStringList& args) {
+	QStringList inputs;
+	if(!parseArguments(args, inputs)) {
+		printUsage();
+		return 2;
+	}
+	QStringList files = collectFiles(inputs);
+	if(files.isEmpty()) {
+		std::cerr << _("No input files found").toLocal8Bit().data() << std::endl;
+		return 2;
+	}
+	if(m_jobs <= 0) {
+		m_jobs = std::max(1, QThread::idealThreadCount());
+	}
+	QString tessdataDir = Config::initTessdataLocation();
+	// The cache is shared with the interactive recognition, whose size setting applies
+	m_resultCache.setMaxSize(m_cache ? QSettings().value("resultcachesize", 100).toLongLong() * 1024 * 1024 : 0);
+	if(m_psm < 0) {
+		m_psm = m_profile->psm;
+	}
+	m_datapath = m_profile->modelPath(tessdataDir, m_language);
+	m_oem = m_profile->oem;
+	if(!m_profile->modelSet.isEmpty() && m_datapath.isEmpty()) {
+		// The engine mode of the profile may not be supported by the installed traineddata
+		m_oem = tesseract::OEM_DEFAULT;
+		std::cerr << _("The traineddata of the %1 profile are not installed for %2, the installed traineddata are used instead").arg(m_profile->name).arg(m_language).toLocal8Bit().data() << std::endl;
+	}
+	if(m_routing && !haveOsd()) {
+		// The script of the blocks cannot be determined
+		m_routing = false;
+		std::cerr << _("The osd traineddata is not installed, the blocks are not routed by script").toLocal8Bit().data() << std::endl;
+	}
+	if(m_retryConfidence > 0 && m_format == Format::Text) {
+		// The confidences are only available in hOCR results
+		m_retryConfidence = 0;
+	}
+
+	bool success = true;
+	for(const QString& file : files) {
+		Summary summary;
+		summary.file = file;
+		processFile(file, summary);
+		printSummary(summary);
+		success &= summary.error.isEmpty() && summary.failed.isEmpty();
+	}
+	return success ? 0 : 1;
+}
+
+bool BatchProcessor::parseArguments(const QStringList& args, QStringList& inputs) {
+	m_profile = &RecognitionProfile::get(RecognitionProfile::Id::Balanced);
+	for(int i = 0, n = args.size(); i < n; ++i) {
+		const QString& arg = args[i];
+		bool hasValue = i + 1 < n;
+		if((arg == "-l" || arg == "--language") && hasValue) {
+			m_language = args[++i];
+		} else if((arg == "-p" || arg == "--psm") && hasValue) {
+			bool ok = false;
+			m_psm = args[++i].toInt(&ok);
+			if(!ok || m_psm < tesseract::PSM_OSD_ONLY || m_psm >= tesseract::PSM_COUNT) {
+				return false;
+			}
+		} else if(arg == "--profile" && hasValue) {
+			m_profile = RecognitionProfile::find(args[++i].toLower());
+			if(!m_profile) {
+				return false;
+			}
+		} else if((arg == "-f" || arg == "--format") && hasValue) {
+			QString format = args[++i].toLower();
+			if(format == "text") {
+				m_format = Format::Text;
+			} else if(format == "hocr") {
+				m_format = Format::HOCR;
+			} else if(format == "pdf") {
+				m_format = Format::PDF;
+			} else {
+				return false;
+			}
+		} else if((arg == "-o" || arg == "--output") && hasValue) {
+			m_outputDir = args[++i];
+		} else if((arg == "-j" || arg == "--jobs") && hasValue) {
+			bool ok = false;
+			m_jobs = args[++i].toInt(&ok);
+			if(!ok) {
+				return false;
+			}
+		} else if((arg == "-t" || arg == "--timeout") && hasValue) {
+			bool ok = false;
+			m_timeout = args[++i].toInt(&ok);
+			// The timeout is passed on in milliseconds
+			if(!ok || m_timeout < 0 || m_timeout > std::numeric_limits<int>::max() / 1000) {
+				return false;
+			}
+		} else if(arg == "--timeout-policy" && hasValue) {
+			QString policy = args[++i].toLower();
+			if(policy == "lower-resolution") {
+				m_timeoutPolicy = Config::TimeoutPolicy::LowerResolution;
+			} else if(policy == "sparse-text") {
+				m_timeoutPolicy = Config::TimeoutPolicy::SparseText;
+			} else if(policy == "skip") {
+				m_timeoutPolicy = Config::TimeoutPolicy::Skip;
+			} else {
+				return false;
+			}
+		} else if(arg == "-d" || arg == "--deskew") {
+			m_deskew = true;
+		} else if(arg == "--skip-blank") {
+			m_skipBlank = true;
+		} else if(arg == "--skip-duplicates") {
+			m_skipDuplicates = true;
+		} else if(arg == "--route-scripts") {
+			m_routing = true;
+		} else if(arg == "--retry-confidence" && hasValue) {
+			bool ok = false;
+			m_retryConfidence = args[++i].toInt(&ok);
+			if(!ok || m_retryConfidence < 0 || m_retryConfidence > 100) {
+				return false;
+			}
+		} else if(arg == "--processes") {
+			m_processes = true;
+		} else if(arg == "--no-cache") {
+			m_cache = false;
+		} else if(arg.startsWith("-")) {
+			return false;
+		} else {
+			inputs.append(arg);
+		}
+	}
+	return !inputs.isEmpty();
+}
+
+QStringList BatchProcessor::collectFiles(const QStringList& inputs) const {
+	QStringList filters = {"*.pdf", "*.djvu"};
+	for(const QByteArray& format : QImageReader::supportedImageFormats()) {
+		filters.append("*." + QString(format));
+	}
+	QStringList files;
+	for(const QString& input : inputs) {
+		QFileInfo info(input);
+		if(info.isDir()) {
+			QStringList dirFiles;
+			QDirIterator it(input, filters, QDir::Files, QDirIterator::Subdirectories);
+			while(it.hasNext()) {
+				dirFiles.append(it.next());
+			}
+			std::sort(dirFiles.begin(), dirFiles.end());
+			files.append(dirFiles);
+		} else if(info.exists()) {
+			files.append(info.filePath());
+		} else {
+			std::cerr << _("No such file or directory: %1").arg(input).toLocal8Bit().data() << std::endl;
+		}
+	}
+	return files;
+}
+
+QString BatchProcessor::outputFilename(const QString& filename) const {
+	QFileInfo info(filename);
+	QString suffix = m_format == Format::Text ? "txt" : m_format == Format::HOCR ? "html" : "pdf";
+	QDir dir(m_outputDir.isEmpty() ? info.absolutePath() : m_outputDir);
+	return dir.absoluteFilePath(QString("%1.%2").arg(info.completeBaseName()).arg(suffix));
+}
+
+void BatchProcessor::processFile(const QString& filename, Summary& summary) {
+	QElapsedTimer timer;
+	timer.start();
+	summary.output = outputFilename(filename);
+	if(QFileInfo(summary.output).absoluteFilePath() == QFileInfo(filename).absoluteFilePath()) {
+		summary.error = _("Cannot overwrite the source file");
+		return;
+	}
+	int nPages = std::unique_ptr<DisplayRenderer>(DisplayRenderer::create(filename, QByteArray()))->getNPages();
+	if(nPages <= 0) {
+		summary.error = _("Failed to open file");
+		return;
+	}
+	int resolution = m_profile->resolution(filename, DisplayRenderer::defaultResolution(filename));
+	QList<Page> pages = recognizePages(filename, nPages, resolution, summary);
+	if(summary.error.isEmpty()) {
+		QDir().mkpath(QFileInfo(summary.output).absolutePath());
+		if(m_format == Format::Text) {
+			writeText(summary.output, pages, summary.error);
+		} else {
+			writeHOCR(filename, summary.output, pages, summary.error);
+		}
+	}
+	summary.seconds = timer.elapsed() / 1000.;
+}
+
+bool BatchProcessor::haveOsd() {
+	bool ok = false;
+	EngineCache::Engine tess = m_engineCache.acquire(m_language, m_oem, m_datapath, &ok);
+	if(!ok) {
+		return false;
+	}
+	GenericVector<STRING> languages;
+	tess->GetAvailableLanguagesAsVector(&languages);
+	for(int i = 0; i < languages.size(); ++i) {
+		if(languages[i] == "osd") {
+			return true;
+		}
+	}
+	return false;
+}
+
+QList<BatchProcessor::Page> BatchProcessor::recognizePages(const QString& filename, int nPages, int resolution, Summary& summary) {
+	summary.pages = nPages;
+	RecognitionPipeline::Options options;
+	options.settings = {m_language, m_oem, m_datapath, m_psm, QString(), QString(), m_retryConfidence};
+	options.routing = m_routing;
+	options.skipBlank = m_skipBlank;
+	options.skipDuplicates = m_skipDuplicates;
+	options.threads = m_jobs;
+	options.processes = m_processes;
+	options.pageTimeout = m_timeout * 1000;
+	options.timeoutPolicy = m_timeoutPolicy;
+	options.resultCache = &m_resultCache;
+	QList<RecognitionPipeline::PageJob> jobs;
+	for(int page = 1; page <= nPages; ++page) {
+		RecognitionPipeline::PageJob job;
+		job.render.file = filename;
+		job.render.page = page;
+		job.render.resolution = resolution;
+		job.deskew = m_deskew;
+		job.newFile = page == 1;
+		job.timingId = -1;
+		jobs.append(job);
+	}
+	Output output(m_format == Format::Text ? OutputEditor::ResultFormat::Text : OutputEditor::ResultFormat::HOCR, nPages);
+	QElapsedTimer timer;
+	timer.start();
+	RecognitionPipeline::Outcome outcome = RecognitionPipeline(jobs, options, m_engineCache, output).run();
+	if(outcome.initFailed) {
+		summary.error = _("Failed to initialize tesseract");
+		return QList<Page>();
+	}
+	m_profile->addThroughput(outcome.recognizedPages, timer.elapsed());
+	for(int pageIdx : outcome.skipped) {
+		summary.skipped.append(pageIdx + 1);
+	}
+	std::sort(summary.skipped.begin(), summary.skipped.end());
+	for(int page = 1; page <= nPages; ++page) {
+		if(output.pages()[page - 1].result.isNull()) {
+			summary.failed.append(page);
+		}
+	}
+	return output.pages();
+}
+
+bool BatchProcessor::writeText(const QString& outname, const QList<Page>& pages, QString& errMsg) const {
+	QFile file(outname);
+	if(!file.open(QIODevice::WriteOnly)) {
+		errMsg = _("Failed to write output");
+		return false;
+	}
+	QStringList results;
+	for(const Page& page : pages) {
+		results.append(page.result);
+	}
+	file.write(results.join("\n").toUtf8());
+	return true;
+}
+
+bool BatchProcessor::writeHOCR(const QString& filename, const QString& outname, const QList<Page>& pages, QString& errMsg) const {
+	QtSpell::TextEditChecker spell;
+	HOCRDocument document(&spell);
+	for(int page = 0, nPages = pages.size(); page < nPages; ++page) {
+		QDomDocument doc;
+		if(pages[page].result.isEmpty() || !doc.setContent(pages[page].result)) {
+			continue;
+		}
+		QDomElement pageDiv = doc.firstChildElement("div");
+		QMap<QString, QString> attrs = HOCRItem::deserializeAttrGroup(pageDiv.attribute("title"));
+		attrs["image"] = QString("'%1'").arg(QFileInfo(filename).absoluteFilePath());
+		attrs["ppageno"] = QString::number(page + 1);
+		attrs["rot"] = QString::number(pages[page].angle);
+		attrs["res"] = QString::number(pages[page].resolution);
+		pageDiv.setAttribute("title", HOCRItem::serializeAttrGroup(attrs));
+		document.addPage(pageDiv, true);
+	}
+	if(document.pageCount() == 0) {
+		errMsg = _("No pages were recognized");
+		return false;
+	}
+
+	if(m_format == Format::PDF) {
+		return HOCRPdfExporter(&document, nullptr, nullptr).exportDocument(outname, errMsg);
+	}
+
+	QFile file(outname);
+	if(!file.open(QIODevice::WriteOnly)) {
+		errMsg = _("Failed to write output");
+		return false;
+	}
+	QString header = QString(
+	                     "<!DOCTYPE html>\n"
+	                     "<html>\n"
+	                     "<head>\n"
+	                     " <title>%1</title>\n"
+	                     " <meta charset=\"utf-8\" /> \n"
+	                     " <meta name='ocr-system' content='tesseract %2' />\n"
+	                     " <meta name='ocr-capabilities' content='ocr_page ocr_carea ocr_par ocr_line ocrx_word'/>\n"
+	                     "</head>\n").arg(QFileInfo(outname).fileName()).arg(tesseract::TessBaseAPI::Version());
+	file.write(header.toUtf8());
+	document.convertSourcePaths(QFileInfo(outname).absolutePath(), false);
+	file.write(document.toHTML().toUtf8());
+	file.write("</html>\n");
+	return true;
+}
+
+void BatchProcessor::printUsage() {
+	std::cerr << _("Usage: %1 batch [options] <file or directory>...").arg(PACKAGE_NAME).toLocal8Bit().data() << std::endl;
+	std::cerr << _("Options:").toLocal8Bit().data() << std::endl;
+	std::cerr << "  -l, --language <lang>  " << _("Recognition language, e.g. eng or eng+deu (default: eng)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --profile <profile>    " << _("Speed and accuracy trade-off (default: balanced):").toLocal8Bit().data() << std::endl;
+	for(const RecognitionProfile& profile : RecognitionProfile::profiles()) {
+		double rate = profile.pagesPerMinute();
+		std::cerr << "      " << profile.name.toLocal8Bit().data();
+		if(rate > 0.) {
+			std::cerr << " " << _("(%1 pages/min measured)").arg(rate, 0, 'f', 1).toLocal8Bit().data();
+		}
+		std::cerr << std::endl;
+	}
+	std::cerr << "  -p, --psm <mode>       " << _("Tesseract page segmentation mode (default: that of the profile)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  -f, --format <format>  " << _("Output format: text, hocr or pdf (default: text)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  -o, --output <dir>     " << _("Output directory (default: directory of the input file)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  -j, --jobs <n>         " << _("Number of pages recognized in parallel (default: number of cores)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  -t, --timeout <secs>   " << _("Time limit for recognizing a page (default: 0, no timeout)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --timeout-policy <p>   " << _("What to do with pages exceeding the time limit (default: skip):").toLocal8Bit().data() << std::endl;
+	std::cerr << "      lower-resolution " << _("retry at half the resolution").toLocal8Bit().data() << std::endl;
+	std::cerr << "      sparse-text      " << _("retry with sparse text segmentation").toLocal8Bit().data() << std::endl;
+	std::cerr << "      skip             " << _("skip the page, it is reported as failed").toLocal8Bit().data() << std::endl;
+	std::cerr << "  -d, --deskew           " << _("Straighten skewed pages before recognizing them").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --skip-blank           " << _("Do not recognize blank pages").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --skip-duplicates      " << _("Do not recognize pages which duplicate an earlier page of the file").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --route-scripts        " << _("Recognize the blocks of multilingual pages with the languages of their script only").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --retry-confidence <n> " << _("Re-recognize lines with words below this confidence, hocr and pdf only (default: 0, none)").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --processes            " << _("Recognize in separate worker processes").toLocal8Bit().data() << std::endl;
+	std::cerr << "  --no-cache             " << _("Do not reuse or store cached recognition results").toLocal8Bit().data() << std::endl;
+}
+
+void BatchProcessor::printSummary(const Summary& summary) {
+	QStringList failed;
+	for(int page : summary.failed) {
+		failed.append(QString::number(page));
+	}
+	QStringList skipped;
+	for(int page : summary.skipped) {
+		skipped.append(QString::number(page));
+	}
+	QString line = QString("{\"file\": %1, \"output\": %2, \"pages\": %3, \"failed_pages\": [%4], \"skipped_pages\": [%5], \"seconds\": %6, \"error\": %7}")
+	               .arg(Utils::jsonString(summary.file),
+	                    summary.error.isEmpty() ? Utils::jsonString(summary.output) : QString("null"),
+	                    QString::number(summary.pages),
+	                    failed.join(", "),
+	                    skipped.join(", "),
+	                    QString::number(summary.seconds, 'f', 2),
+	                    summary.error.isEmpty() ? QString("null") : Utils::jsonString(summary.error));
+	std::cout << line.toUtf8().data() << std::endl;
+}
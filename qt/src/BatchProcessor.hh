@@ -0,0 +1,89 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * BatchProcessor.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHPROCESSOR_HH
+#define BATCHPROCESSOR_HH
+
+#include <QList>
+#include <QStringList>
+
+#include "Config.hh"
+#include "EngineCache.hh"
+#include "ResultCache.hh"
+
+class RecognitionProfile;
+
+// Recognizes files and directories without user interface, for the "batch" subcommand.
+// For each input file, a summary line in JSON format is written to stdout.
+class BatchProcessor {
+public:
+	static bool isBatchCommand(int argc, char* argv[]);
+	int run(const QStringList& args);
+
+private:
+	class Output;
+	enum class Format { Text, HOCR, PDF };
+	struct Page {
+		QString result; // Null if the page failed to render or to be recognized
+		double angle = 0.;
+		int resolution = 0;
+	};
+	struct Summary {
+		QString file;
+		QString output;
+		int pages = 0;
+		QList<int> failed;
+		QList<int> skipped;
+		double seconds = 0.;
+		QString error;
+	};
+
+	QString m_language = "eng";
+	const RecognitionProfile* m_profile = nullptr;
+	int m_psm = -1; // Default of the profile
+	int m_oem = 0;
+	QString m_datapath;
+	Format m_format = Format::Text;
+	QString m_outputDir;
+	int m_jobs = 0;
+	int m_timeout = 0; // Seconds per page, zero for none
+	Config::TimeoutPolicy m_timeoutPolicy = Config::TimeoutPolicy::Skip;
+	bool m_deskew = false;
+	bool m_skipBlank = false;
+	bool m_skipDuplicates = false;
+	bool m_routing = false;
+	int m_retryConfidence = 0;
+	bool m_processes = false;
+	bool m_cache = true;
+	EngineCache m_engineCache;
+	ResultCache m_resultCache;
+
+	bool parseArguments(const QStringList& args, QStringList& inputs);
+	QStringList collectFiles(const QStringList& inputs) const;
+	QString outputFilename(const QString& filename) const;
+	void processFile(const QString& filename, Summary& summary);
+	bool haveOsd();
+	QList<Page> recognizePages(const QString& filename, int nPages, int resolution, Summary& summary);
+	bool writeText(const QString& outname, const QList<Page>& pages, QString& errMsg) const;
+	bool writeHOCR(const QString& filename, const QString& outname, const QList<Page>& pages, QString& errMsg) const;
+	static void printUsage();
+	static void printSummary(const Summary& summary);
+};
+
+#endif // BATCHPROCESSOR_HH
@@ -0,0 +1,150 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * ConfidenceRetry.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QDomDocument>
+#include <QImage>
+#include <QRect>
+#include <QStringList>
+#include <algorithm>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+
+#include "ConfidenceRetry.hh"
+#include "HOCRDocument.hh"
+#include "Utils.hh"
+
+namespace ConfidenceRetry {
+
+struct Alternative {
+	int psm; // tesseract::PageSegMode
+	int scale; // Factor by which the line is upscaled, i.e. the resolution is increased
+};
+
+// Tried in order until all words of the line reach the threshold
+static const Alternative ALTERNATIVES[] = {
+	{tesseract::PSM_SINGLE_LINE, 1},
+	{tesseract::PSM_SINGLE_LINE, 2},
+	{tesseract::PSM_RAW_LINE, 2}
+};
+
+static const QStringList LINE_CLASSES = {"ocr_line", "ocr_caption", "ocr_textfloat", "ocr_header"};
+
+static QRect parseBBox(const QDomElement& element) {
+	QStringList coords = HOCRItem::deserializeAttrGroup(element.attribute("title"))["bbox"].split(" ", QString::SkipEmptyParts);
+	if(coords.size() != 4) {
+		return QRect();
+	}
+	QRect bbox;
+	bbox.setCoords(coords[0].toInt(), coords[1].toInt(), coords[2].toInt(), coords[3].toInt());
+	return bbox;
+}
+
+static void collectElements(const QDomElement& parent, const QStringList& classes, QList<QDomElement>& elements) {
+	for(QDomElement child = parent.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+		if(classes.contains(child.attribute("class"))) {
+			elements.append(child);
+		} else {
+			collectElements(child, classes, elements);
+		}
+	}
+}
+
+// Mean and minimum confidence of the words, false if there are none
+static bool wordConfidences(const QList<QDomElement>& words, double& mean, int& min) {
+	if(words.isEmpty()) {
+		return false;
+	}
+	int sum = 0;
+	min = 100;
+	for(const QDomElement& word : words) {
+		int conf = HOCRItem::deserializeAttrGroup(word.attribute("title"))["x_wconf"].toInt();
+		sum += conf;
+		min = std::min(min, conf);
+	}
+	mean = double(sum) / words.size();
+	return true;
+}
+
+QString improve(const QString& hocr, const QImage& image, int resolution, int threshold, const RecognizeFunc& recognize) {
+	QDomDocument doc;
+	if(threshold <= 0 || !doc.setContent(hocr)) {
+		return hocr;
+	}
+	QList<QDomElement> lines;
+	collectElements(doc.documentElement(), LINE_CLASSES, lines);
+	bool changed = false;
+	for(QDomElement& line : lines) {
+		QList<QDomElement> words;
+		collectElements(line, {"ocrx_word"}, words);
+		double bestMean;
+		int min;
+		if(!wordConfidences(words, bestMean, min) || min >= threshold) {
+			continue;
+		}
+		// Include some margin, tesseract recognizes glyphs touching the image border poorly
+		QRect bbox = parseBBox(line);
+		int margin = std::max(2, bbox.height() / 4);
+		QRect rect = bbox.adjusted(-margin, -margin, margin, margin).intersected(image.rect());
+		if(rect.isEmpty()) {
+			continue;
+		}
+		QImage lineImage = image.copy(rect);
+		QDomDocument bestDoc; // Owns the best words
+		QList<QDomElement> bestWords;
+		for(const Alternative& alternative : ALTERNATIVES) {
+			QImage scaled = Utils::ocrImage(alternative.scale == 1 ? lineImage : lineImage.scaled(lineImage.size() * alternative.scale, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+			QString result = recognize(scaled, alternative.psm, resolution * alternative.scale);
+			QDomDocument altDoc;
+			if(result.isEmpty() || !altDoc.setContent(result)) {
+				continue;
+			}
+			QList<QDomElement> altWords;
+			collectElements(altDoc.documentElement(), {"ocrx_word"}, altWords);
+			double mean;
+			if(wordConfidences(altWords, mean, min) && mean > bestMean) {
+				// Map the words recognized from the (upscaled) line image to the page
+				for(const QDomElement& word : altWords) {
+					HOCRItem::mapBBoxes(word, rect.topLeft(), 1. / alternative.scale);
+				}
+				bestMean = mean;
+				bestDoc = altDoc;
+				bestWords = altWords;
+				if(min >= threshold) {
+					break;
+				}
+			}
+		}
+		if(bestWords.isEmpty()) {
+			continue;
+		}
+		// Replace the words of the line, the line itself keeps its bounding box and baseline
+		for(const QDomElement& word : words) {
+			word.parentNode().removeChild(word);
+		}
+		for(const QDomElement& word : bestWords) {
+			line.appendChild(doc.importNode(word, true));
+		}
+		changed = true;
+	}
+	return changed ? doc.toString() : hocr;
+}
+
+} // ConfidenceRetry
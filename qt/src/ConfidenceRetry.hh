@@ -0,0 +1,44 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * ConfidenceRetry.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CONFIDENCERETRY_HH
+#define CONFIDENCERETRY_HH
+
+#include <QString>
+#include <functional>
+
+class QImage;
+
+// Second recognition pass over the poorly recognized parts of an hOCR result: only
+// the lines containing words below the confidence threshold are recognized once
+// more, with alternative settings, and the result with the better confidence is
+// kept. The cost of the pass is thus proportional to the poorly recognized lines.
+namespace ConfidenceRetry {
+
+// Recognizes an image with the given page segmentation mode at the given resolution,
+// returns the hOCR result or an empty string if the recognition failed or was cancelled
+typedef std::function<QString(const QImage& image, int psm, int resolution)> RecognizeFunc;
+
+// Returns the improved hOCR result, image is the image the result was recognized from
+QString improve(const QString& hocr, const QImage& image, int resolution, int threshold, const RecognizeFunc& recognize);
+
+}
+
+#endif // CONFIDENCERETRY_HH
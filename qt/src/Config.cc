@@ -19,17 +19,23 @@
 
 #include "Config.hh"
 #include "ConfigSettings.hh"
+#include "EngineCache.hh"
 #include "LangTables.hh"
 #include "MainWindow.hh"
+#include "RenderCache.hh"
+#include "ResultCache.hh"
 #include "Utils.hh"
 
 #include <QDesktopServices>
 #include <QDir>
 #include <QMultiMap>
+#include <QMutexLocker>
+#include <QThread>
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
 #include <QStandardPaths>
 #endif
 #include <QUrl>
+#include <algorithm>
 #include <enchant-provider.h>
 #define USE_STD_NAMESPACE
 #include <tesseract/baseapi.h>
@@ -85,6 +91,10 @@ Config::Config(QWidget* parent)
 	connect(ui.lineEditLangName, SIGNAL(textChanged(QString)), this, SLOT(clearLineEditErrorState()));
 	connect(ui.lineEditLangCode, SIGNAL(textChanged(QString)), this, SLOT(clearLineEditErrorState()));
 	connect(ui.comboBoxDataLocation, SIGNAL(currentIndexChanged(int)), this, SLOT(setDataLocations(int)));
+	connect(ui.pushButtonClearResultCache, SIGNAL(clicked()), this, SLOT(clearResultCache()));
+	connect(ui.pushButtonClearRenderCache, SIGNAL(clicked()), this, SLOT(clearRenderCache()));
+	connect(ui.spinBoxRenderCacheSize, SIGNAL(valueChanged(int)), this, SLOT(updateRenderCacheStats()));
+	connect(ui.spinBoxPageTimeout, SIGNAL(valueChanged(int)), this, SLOT(updateTimeoutPolicyState()));
 
 	ADD_SETTING(SwitchSetting("dictinstall", ui.checkBoxDictInstall, true));
 	ADD_SETTING(SwitchSetting("updatecheck", ui.checkBoxUpdateCheck, true));
@@ -93,6 +103,19 @@ Config::Config(QWidget* parent)
 	ADD_SETTING(SwitchSetting("systemoutputfont", ui.checkBoxDefaultOutputFont, true));
 	ADD_SETTING(FontSetting("customoutputfont", &m_fontDialog, QFont().toString()));
 	ADD_SETTING(ComboSetting("textencoding", ui.comboBoxEncoding, 0));
+	ADD_SETTING(SpinSetting("ocrthreads", ui.spinBoxRecognitionThreads, 0));
+	ADD_SETTING(SpinSetting("resultcachesize", ui.spinBoxResultCacheSize, 100));
+	ADD_SETTING(SpinSetting("rendercachesize", ui.spinBoxRenderCacheSize, 256));
+	ADD_SETTING(SpinSetting("prefetchpages", ui.spinBoxPrefetchPages, 2));
+	ADD_SETTING(SwitchSetting("progressiverendering", ui.checkBoxProgressiveRendering, true));
+	ADD_SETTING(SwitchSetting("ocrprocesses", ui.checkBoxRecognitionProcesses, false));
+	ADD_SETTING(SpinSetting("pagetimeout", ui.spinBoxPageTimeout, 0));
+	ADD_SETTING(ComboSetting("timeoutpolicy", ui.comboBoxTimeoutPolicy, 0));
+	ADD_SETTING(SpinSetting("retryconfidence", ui.spinBoxRetryConfidence, 0));
+	ADD_SETTING(SwitchSetting("ocrdeskew", ui.checkBoxDeskew, false));
+	ADD_SETTING(SwitchSetting("ocrskipblank", ui.checkBoxSkipBlankPages, false));
+	ADD_SETTING(SwitchSetting("ocrskipduplicates", ui.checkBoxSkipDuplicatePages, false));
+	ADD_SETTING(SwitchSetting("ocrscriptrouting", ui.checkBoxScriptRouting, false));
 	ADD_SETTING(ComboSetting("datadirs", ui.comboBoxDataLocation, 0));
 	ADD_SETTING(VarSetting<QString>("sourcedir", Utils::documentsFolder()));
 	ADD_SETTING(VarSetting<QString>("outputdir", Utils::documentsFolder()));
@@ -125,6 +148,9 @@ QList<QString> Config::searchLangCultures(const QString& code) const {
 
 void Config::showDialog() {
 	toggleAddLanguage(true);
+	updateResultCacheStats();
+	updateRenderCacheStats();
+	updateTimeoutPolicyState();
 	exec();
 	ConfigSettings::get<TableSetting>("customlangs")->serialize();
 }
@@ -133,6 +159,92 @@ bool Config::useUtf8() const {
 	return ui.comboBoxEncoding->currentIndex() == 1;
 }
 
+int Config::recognitionThreads() const {
+	int threads = ui.spinBoxRecognitionThreads->value();
+	return threads > 0 ? threads : std::max(1, QThread::idealThreadCount());
+}
+
+bool Config::recognitionProcesses() const {
+	return ui.checkBoxRecognitionProcesses->isChecked();
+}
+
+int Config::pageTimeout() const {
+	return ui.spinBoxPageTimeout->value() * 1000;
+}
+
+Config::TimeoutPolicy Config::timeoutPolicy() const {
+	return static_cast<TimeoutPolicy>(ui.comboBoxTimeoutPolicy->currentIndex());
+}
+
+int Config::retryConfidence() const {
+	return ui.spinBoxRetryConfidence->value();
+}
+
+bool Config::deskewPages() const {
+	return ui.checkBoxDeskew->isChecked();
+}
+
+bool Config::skipBlankPages() const {
+	return ui.checkBoxSkipBlankPages->isChecked();
+}
+
+bool Config::skipDuplicatePages() const {
+	return ui.checkBoxSkipDuplicatePages->isChecked();
+}
+
+bool Config::scriptRouting() const {
+	return ui.checkBoxScriptRouting->isChecked();
+}
+
+qint64 Config::resultCacheSize() const {
+	return qint64(ui.spinBoxResultCacheSize->value()) * 1024 * 1024;
+}
+
+qint64 Config::renderCacheSize() const {
+	return qint64(ui.spinBoxRenderCacheSize->value()) * 1024 * 1024;
+}
+
+int Config::prefetchPages() const {
+	return ui.spinBoxPrefetchPages->value();
+}
+
+bool Config::progressiveRendering() const {
+	return ui.checkBoxProgressiveRendering->isChecked();
+}
+
+void Config::updateTimeoutPolicyState() {
+	ui.comboBoxTimeoutPolicy->setEnabled(ui.spinBoxPageTimeout->value() > 0);
+}
+
+void Config::clearResultCache() {
+	MAIN->getResultCache()->clear();
+	updateResultCacheStats();
+}
+
+void Config::updateResultCacheStats() {
+	ResultCache* cache = MAIN->getResultCache();
+	cache->setMaxSize(resultCacheSize());
+	ui.labelResultCacheStats->setText(_("%1 MB used, %2 hits, %3 misses").arg(cache->size() / (1024. * 1024.), 0, 'f', 1).arg(cache->hits()).arg(cache->misses()));
+	ui.pushButtonClearResultCache->setEnabled(cache->size() > 0);
+}
+
+void Config::clearRenderCache() {
+	MAIN->getRenderCache()->clear();
+	updateRenderCacheStats();
+}
+
+void Config::updateRenderCacheStats() {
+	RenderCache* cache = MAIN->getRenderCache();
+	if(!cache) {
+		return;
+	}
+	cache->setMaxSize(renderCacheSize());
+	int lookups = cache->hits() + cache->misses();
+	double hitRate = lookups > 0 ? 100. * cache->hits() / lookups : 0.;
+	ui.labelRenderCacheStats->setText(_("%1 MB used, %2 hits, %3 misses (%4% hit rate)").arg(cache->size() / (1024. * 1024.), 0, 'f', 1).arg(cache->hits()).arg(cache->misses()).arg(hitRate, 0, 'f', 0));
+	ui.pushButtonClearRenderCache->setEnabled(cache->size() > 0);
+}
+
 bool Config::useSystemDataLocations() const {
 	return ui.comboBoxDataLocation->currentIndex() == 0;
 }
@@ -172,6 +284,11 @@ void Config::openSpellingDir() {
 	QDesktopServices::openUrl(QUrl::fromLocalFile(spellingDir));
 }
 
+QString Config::initTessdataLocation() {
+	int idx = QSettings().value("datadirs").toInt();
+	return tessdataLocation(static_cast<Location>(idx));
+}
+
 QString Config::spellingLocation(Location location) {
 	if(location == SystemLocation) {
 #ifdef Q_OS_WIN
@@ -232,11 +349,13 @@ QString Config::tessdataLocation(Location location) {
 #endif
 		qputenv("TESSDATA_PREFIX", configDir.absoluteFilePath("tessdata").toLocal8Bit());
 	}
+	QMutexLocker locker(&EngineCache::initMutex());
 	QByteArray current = setlocale(LC_ALL, NULL);
 	setlocale(LC_ALL, "C");
 	tesseract::TessBaseAPI tess;
 	tess.Init(nullptr, nullptr);
 	setlocale(LC_ALL, current.constData());
+	locker.unlock();
 	return QString(tess.GetDatapath());
 }
 
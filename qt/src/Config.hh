@@ -32,6 +32,8 @@ public:
 	struct Lang {
 		QString prefix, code, name;
 	};
+	// What to do with a page whose recognition exceeded the page timeout
+	enum class TimeoutPolicy { LowerResolution, SparseText, Skip };
 
 	Config(QWidget* parent = nullptr);
 
@@ -40,12 +42,27 @@ public:
 	void showDialog();
 
 	bool useUtf8() const;
+	int recognitionThreads() const;
+	bool recognitionProcesses() const;
+	int pageTimeout() const; // In milliseconds, zero for none
+	TimeoutPolicy timeoutPolicy() const;
+	int retryConfidence() const; // Zero for none
+	bool deskewPages() const;
+	bool skipBlankPages() const;
+	bool skipDuplicatePages() const;
+	bool scriptRouting() const;
+	qint64 resultCacheSize() const;
+	qint64 renderCacheSize() const;
+	int prefetchPages() const; // Before and after the displayed page
+	bool progressiveRendering() const;
 	bool useSystemDataLocations() const;
 	QString tessdataLocation() const;
 	QString spellingLocation() const;
 
 	static void openTessdataDir();
 	static void openSpellingDir();
+	// Points tesseract to the configured tessdata location, for use without config dialog. Returns the tessdata directory.
+	static QString initTessdataLocation();
 	static QString lookupLangCode(const QString& prefix) { return LANG_LOOKUP[prefix]; }
 
 public slots:
@@ -70,6 +87,11 @@ private slots:
 	void updateFontButton(const QFont& font);
 	void langTableSelectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
 	void clearLineEditErrorState();
+	void clearResultCache();
+	void clearRenderCache();
+	void updateTimeoutPolicyState();
+	void updateResultCacheStats();
+	void updateRenderCacheStats();
 	void setDataLocations(int idx);
 	void toggleAddLanguage(bool forceHide = false);
 };
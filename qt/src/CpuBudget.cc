@@ -0,0 +1,144 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * CpuBudget.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QThread>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "CpuBudget.hh"
+
+// A throughput window spans at least this long and two items per worker
+static const int WINDOW_MIN_MSECS = 5000;
+// Throughput changes within this fraction are considered noise
+static const double WINDOW_RATE_TOLERANCE = 0.05;
+
+CpuBudget& CpuBudget::instance() {
+	static CpuBudget budget;
+	return budget;
+}
+
+CpuBudget::CpuBudget() {
+	m_cores = std::max(1, QThread::idealThreadCount());
+}
+
+int CpuBudget::share(int nThreads) const {
+	return std::max(1, m_cores / std::max(1, nThreads));
+}
+
+void CpuBudget::setThreadShare(int nThreads) {
+#ifdef _OPENMP
+	// Both settings only apply to the calling thread. Parallel regions with an explicit thread
+	// count, as some of tesseract's, are only bounded by OMP_THREAD_LIMIT, which the OpenMP
+	// runtime reads at startup. Worker processes are started with it.
+	omp_set_dynamic(1);
+	omp_set_num_threads(std::max(1, nThreads));
+#else
+	Q_UNUSED(nThreads);
+#endif
+}
+
+int CpuBudget::threadShare() {
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return std::max(1, QThread::idealThreadCount());
+#endif
+}
+
+void CpuBudget::beginInteractive() {
+	QMutexLocker locker(&m_mutex);
+	++m_interactive;
+}
+
+void CpuBudget::endInteractive() {
+	QMutexLocker locker(&m_mutex);
+	--m_interactive;
+	m_cond.wakeAll();
+}
+
+void CpuBudget::beginBatch(int maxWorkers) {
+	QMutexLocker locker(&m_mutex);
+	m_batchMax = std::max(1, maxWorkers);
+	m_batchLimit = m_batchMax;
+	m_batchBusy = 0;
+	m_windowItems = 0;
+	m_windowRate = 0.;
+	// Oversubscription is the more likely problem, hence first try with fewer workers
+	m_step = -1;
+	m_windowTimer.start();
+}
+
+void CpuBudget::endBatch() {
+	QMutexLocker locker(&m_mutex);
+	m_batchMax = m_batchLimit = 1;
+	m_cond.wakeAll();
+}
+
+int CpuBudget::batchSlots() const {
+	// Called with m_mutex locked. Interactive work reserves half of the cores.
+	if(m_interactive > 0) {
+		return std::max(1, std::min(m_batchLimit, m_cores - std::max(1, m_cores / 2)));
+	}
+	return m_batchLimit;
+}
+
+void CpuBudget::acquireBatchSlot() {
+	QMutexLocker locker(&m_mutex);
+	while(m_batchBusy >= batchSlots()) {
+		m_cond.wait(&m_mutex);
+	}
+	++m_batchBusy;
+	int nThreads = share(m_batchLimit);
+	locker.unlock();
+	setThreadShare(nThreads);
+}
+
+void CpuBudget::releaseBatchSlot(bool completed) {
+	QMutexLocker locker(&m_mutex);
+	--m_batchBusy;
+	if(completed) {
+		adaptBatchLimit();
+	}
+	m_cond.wakeAll();
+}
+
+void CpuBudget::adaptBatchLimit() {
+	// Called with m_mutex locked. Hill climbing: keep changing the limit in the same direction
+	// as long as the throughput does not drop, otherwise reverse the direction.
+	++m_windowItems;
+	qint64 elapsed = m_windowTimer.elapsed();
+	if(m_windowItems < 2 * m_batchLimit || elapsed < WINDOW_MIN_MSECS) {
+		return;
+	}
+	double rate = m_windowItems * 1000. / elapsed;
+	if(m_windowRate > 0. && rate < m_windowRate * (1. - WINDOW_RATE_TOLERANCE)) {
+		m_step = -m_step;
+	}
+	m_windowRate = rate;
+	int limit = std::max(1, std::min(m_batchLimit + m_step, m_batchMax));
+	if(limit == m_batchLimit) {
+		// At a bound, the next change can only go the other way
+		m_step = -m_step;
+	}
+	m_batchLimit = limit;
+	m_windowItems = 0;
+	m_windowTimer.restart();
+}
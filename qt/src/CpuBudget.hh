@@ -0,0 +1,89 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * CpuBudget.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CPUBUDGET_HH
+#define CPUBUDGET_HH
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Shares the processor cores between the concurrent activities of the application:
+// the recognition workers, the OpenMP threads of tesseract and of the image adjustments,
+// and the rendering for the displayer. Interactive rendering takes precedence, while it
+// runs fewer recognition workers may start a work item. The number of workers of a batch
+// follows the measured throughput, so that the machine is not oversubscribed.
+class CpuBudget {
+public:
+	// Marks interactive work for the duration of its scope
+	class Interactive {
+	public:
+		Interactive() {
+			CpuBudget::instance().beginInteractive();
+		}
+		~Interactive() {
+			CpuBudget::instance().endInteractive();
+		}
+	};
+
+	static CpuBudget& instance();
+
+	int cores() const {
+		return m_cores;
+	}
+	// Cores for each of the given number of concurrently working threads
+	int share(int nThreads) const;
+	// Limits the OpenMP threads of the parallel regions started by the calling thread, i.e. of
+	// tesseract and of the image adjustments, and lets the OpenMP runtime reduce them further
+	// while the machine is loaded.
+	static void setThreadShare(int nThreads);
+	// Threads available to parallel work started by the calling thread
+	static int threadShare();
+
+	// Starts a batch of work items, i.e. the pages of a recognition job, which are processed by up to maxWorkers threads
+	void beginBatch(int maxWorkers);
+	void endBatch();
+	// Called by the threads of the batch before each work item. Blocks while the batch is at
+	// its concurrency limit and sets the share of the calling thread.
+	void acquireBatchSlot();
+	// Called after each work item. Completed items count towards the measured throughput.
+	void releaseBatchSlot(bool completed);
+
+private:
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	int m_cores;
+	int m_interactive = 0;
+	int m_batchMax = 1;
+	int m_batchLimit = 1;
+	int m_batchBusy = 0;
+	// Throughput of the batch, measured over windows of completed items
+	QElapsedTimer m_windowTimer;
+	int m_windowItems = 0;
+	double m_windowRate = 0.;
+	int m_step = -1;
+
+	CpuBudget();
+	void beginInteractive();
+	void endInteractive();
+	int batchSlots() const;
+	void adaptBatchLimit();
+};
+
+#endif // CPUBUDGET_HH
@@ -0,0 +1,195 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * Deskew.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QImage>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "CpuBudget.hh"
+#include "Deskew.hh"
+
+// Largest skew which is corrected, in degrees
+static const double MAX_SKEW = 10.0;
+// The profiles are first compared at coarse angle steps, then refined around the best coarse angle
+static const double COARSE_STEP = 0.5;
+static const double FINE_STEP = 0.05;
+// Dark pixels beyond this count are subsampled
+static const int MAX_POINTS = 200000;
+// Pages with fewer dark pixels are not deskewed
+static const int MIN_POINTS = 100;
+
+namespace Deskew {
+
+class ScoreThread : public QThread {
+public:
+	ScoreThread(const std::function<void()>& f) : m_f(f) {}
+private:
+	std::function<void()> m_f;
+	void run() override {
+		m_f();
+	}
+};
+
+// Otsu's threshold of the gray level histogram
+static int otsuThreshold(const std::vector<int>& histogram, int total) {
+	double sum = 0.;
+	for(int i = 0; i < 256; ++i) {
+		sum += i * double(histogram[i]);
+	}
+	double sumBackground = 0.;
+	int countBackground = 0;
+	double bestVariance = -1.;
+	int threshold = 127;
+	for(int i = 0; i < 256; ++i) {
+		countBackground += histogram[i];
+		int countForeground = total - countBackground;
+		if(countBackground == 0) {
+			continue;
+		}
+		if(countForeground == 0) {
+			break;
+		}
+		sumBackground += i * double(histogram[i]);
+		double meanBackground = sumBackground / countBackground;
+		double meanForeground = (sum - sumBackground) / countForeground;
+		double variance = double(countBackground) * double(countForeground) * (meanBackground - meanForeground) * (meanBackground - meanForeground);
+		if(variance > bestVariance) {
+			bestVariance = variance;
+			threshold = i;
+		}
+	}
+	return threshold;
+}
+
+// Sharpness of the profile of the rows of the points rotated by the angle. Text lines which are
+// aligned with the rows produce alternating full and empty rows, i.e. large differences between
+// neighbouring rows.
+static double profileScore(const std::vector<float>& xs, const std::vector<float>& ys, int offset, double angle, std::vector<int>& profile) {
+	float sina = std::sin(angle / 180. * M_PI);
+	float cosa = std::cos(angle / 180. * M_PI);
+	std::fill(profile.begin(), profile.end(), 0);
+	const float* x = xs.data();
+	const float* y = ys.data();
+	int* bins = profile.data();
+	for(int i = 0, n = xs.size(); i < n; ++i) {
+		++bins[int(x[i] * sina + y[i] * cosa + offset)];
+	}
+	double score = 0.;
+	for(int i = 1, n = profile.size(); i < n; ++i) {
+		double diff = bins[i] - bins[i - 1];
+		score += diff * diff;
+	}
+	return score;
+}
+
+// Returns the angle of the given ones, symmetric around a center angle, with the best profile.
+// The angles are distributed over the cores available to the calling thread.
+static double bestAngle(const std::vector<float>& xs, const std::vector<float>& ys, int offset, const std::vector<double>& angles) {
+	std::vector<double> scores(angles.size());
+	int nThreads = std::max(1, std::min(CpuBudget::threadShare(), int(angles.size())));
+	std::vector<ScoreThread*> threads;
+	for(int t = 0; t < nThreads; ++t) {
+		threads.push_back(new ScoreThread([&, t] {
+			std::vector<int> profile(2 * offset + 2);
+			for(int i = t, n = angles.size(); i < n; i += nThreads) {
+				scores[i] = profileScore(xs, ys, offset, angles[i], profile);
+			}
+		}));
+		threads.back()->start();
+	}
+	for(ScoreThread* thread : threads) {
+		thread->wait();
+		delete thread;
+	}
+	// Prefer the center angle if the profiles are alike, i.e. for an empty page
+	int best = angles.size() / 2;
+	for(int i = 0, n = angles.size(); i < n; ++i) {
+		if(scores[i] > scores[best]) {
+			best = i;
+		}
+	}
+	return angles[best];
+}
+
+static std::vector<double> angleRange(double center, double range, double step) {
+	std::vector<double> angles;
+	int n = qRound(range / step);
+	for(int i = -n; i <= n; ++i) {
+		angles.push_back(center + i * step);
+	}
+	return angles;
+}
+
+double estimateAngle(const QImage& image, double angle) {
+	QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+	int width = rgb.width();
+	int height = rgb.height();
+	if(width == 0 || height == 0) {
+		return angle;
+	}
+
+	// Binarize the image
+	std::vector<unsigned char> gray(width * height);
+	std::vector<int> histogram(256, 0);
+	for(int y = 0; y < height; ++y) {
+		const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+		unsigned char* grayLine = &gray[y * width];
+		for(int x = 0; x < width; ++x) {
+			grayLine[x] = qGray(line[x]);
+			++histogram[grayLine[x]];
+		}
+	}
+	int threshold = otsuThreshold(histogram, width * height);
+	int nDark = 0;
+	for(int i = 0; i <= threshold; ++i) {
+		nDark += histogram[i];
+	}
+	if(nDark < MIN_POINTS) {
+		return angle;
+	}
+
+	// Collect the dark pixels relative to the image center, rotating a point only requires its coordinates
+	int step = std::max(1, nDark / MAX_POINTS);
+	std::vector<float> xs, ys;
+	xs.reserve(nDark / step + 1);
+	ys.reserve(nDark / step + 1);
+	int count = 0;
+	for(int y = 0; y < height; ++y) {
+		const unsigned char* grayLine = &gray[y * width];
+		for(int x = 0; x < width; ++x) {
+			if(grayLine[x] <= threshold && count++ % step == 0) {
+				xs.push_back(x - 0.5f * width);
+				ys.push_back(y - 0.5f * height);
+			}
+		}
+	}
+	// Rotated points are at most half the diagonal away from the center
+	int offset = int(std::ceil(0.5 * std::sqrt(double(width) * width + double(height) * height))) + 1;
+
+	double best = bestAngle(xs, ys, offset, angleRange(angle, MAX_SKEW, COARSE_STEP));
+	best = bestAngle(xs, ys, offset, angleRange(best, COARSE_STEP, FINE_STEP));
+	// The rotation is specified in tenths of a degree
+	best = qRound(best * 10.0) / 10.0;
+	return best < 0.0 ? best + 360.0 : best >= 360.0 ? best - 360.0 : best;
+}
+
+} // Deskew
@@ -0,0 +1,36 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * Deskew.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DESKEW_HH
+#define DESKEW_HH
+
+class QImage;
+
+namespace Deskew {
+
+// Estimates the skew of the text lines of the image from the projection profiles of its
+// binarized pixels. Returns the angle in degrees, near the given rotation angle, by which
+// the image is to be rotated such that its text lines are horizontal. The image should
+// be downscaled to a low resolution, the estimation does not improve with more pixels.
+double estimateAngle(const QImage& image, double angle);
+
+}
+
+#endif // DESKEW_HH
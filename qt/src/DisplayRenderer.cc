@@ -18,6 +18,7 @@
  */
 
 #include <QImageReader>
+#include <QMutexLocker>
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <poppler-qt4.h>
 #else
@@ -29,10 +30,49 @@
 #include "DisplayRenderer.hh"
 #include "Utils.hh"
 
+DisplayRenderer* DisplayRenderer::create(const QString& filename, const QByteArray& password) {
+	if(filename.endsWith(".pdf", Qt::CaseInsensitive)) {
+		return new PDFRenderer(filename, password);
+	} else if(filename.endsWith(".djvu", Qt::CaseInsensitive)) {
+		return new DJVURenderer(filename);
+	} else {
+		return new ImageRenderer(filename);
+	}
+}
+
+int DisplayRenderer::defaultResolution(const QString& filename) {
+	return isDocument(filename) ? 300 : 100;
+}
+
+bool DisplayRenderer::isDocument(const QString& filename) {
+	return filename.endsWith(".pdf", Qt::CaseInsensitive) || filename.endsWith(".djvu", Qt::CaseInsensitive);
+}
+
+QImage DisplayRenderer::render(int page, double resolution) const {
+	return renderPage(page, resolution, false).convertToFormat(QImage::Format_RGB32);
+}
+
+QImage DisplayRenderer::renderNative(int page, double resolution) const {
+	return Utils::ocrImage(renderPage(page, resolution, true));
+}
+
+QImage DisplayRenderer::renderRegion(int page, double resolution, const QRect& region) const {
+	return renderPageRegion(page, resolution, region).convertToFormat(QImage::Format_RGB32);
+}
+
 void DisplayRenderer::adjustImage(QImage& image, int brightness, int contrast, bool invert) const {
 	if(brightness == 0 && contrast == 0 && !invert) {
 		return;
 	}
+	if(image.depth() == 1) {
+		if(brightness == 0 && contrast == 0) {
+			// 1 remains white, see Utils::ocrImage
+			image.invertPixels();
+			return;
+		}
+		// Brightness and contrast adjustments yield shades of gray
+		image = Utils::ocrImage(image.convertToFormat(QImage::Format_RGB32));
+	}
 
 	double kBr = 1.0 - std::abs(brightness / 200.0);
 	double dBr = brightness > 0 ? 255.0 : 0.0;
@@ -40,92 +80,146 @@ void DisplayRenderer::adjustImage(QImage& image, int brightness, int contrast, b
 	double kCn = contrast * 2.55;
 	double FCn = (259.0 * (kCn + 255.0)) / (255.0 * (259.0 - kCn));
 
-	int nLinePixels = image.bytesPerLine() / 4;
+	// The adjustments act on each channel independently, hence they can be tabulated
+	unsigned char table[256];
+	for(int value = 0; value < 256; ++value) {
+		// Brightness
+		int adjusted = dBr * (1.0 - kBr) + value * kBr;
+		// Contrast
+		adjusted = std::max(0.0, std::min(FCn * (adjusted - 128.0) + 128.0, 255.0));
+		// Invert
+		if(invert) {
+			adjusted = 255 - adjusted;
+		}
+		table[value] = adjusted;
+	}
+
 	int nLines = image.height();
+	if(image.depth() == 8) {
+		int nLinePixels = image.width();
+		#pragma omp parallel for
+		for(int line = 0; line < nLines; ++line) {
+			uchar* gray = image.scanLine(line);
+			for(int i = 0; i < nLinePixels; ++i) {
+				gray[i] = table[gray[i]];
+			}
+		}
+		return;
+	}
+	int nLinePixels = image.bytesPerLine() / 4;
 	#pragma omp parallel for
 	for(int line = 0; line < nLines; ++line) {
 		QRgb* rgb = reinterpret_cast<QRgb*>(image.scanLine(line));
 		for(int i = 0; i < nLinePixels; ++i) {
-			int red = qRed(rgb[i]);
-			int green = qGreen(rgb[i]);
-			int blue = qBlue(rgb[i]);
-			// Brighntess
-			red = dBr * (1.0 - kBr) + red * kBr;
-			green = dBr * (1.0 - kBr) + green * kBr;
-			blue = dBr * (1.0 - kBr) + blue * kBr;
-			// Contrast
-			red = std::max(0.0, std::min(FCn * (red - 128.0) + 128.0, 255.0));
-			green = std::max(0.0, std::min(FCn * (green - 128.0) + 128.0, 255.0));
-			blue = std::max(0.0, std::min(FCn * (blue - 128.0) + 128.0, 255.0));
-			// Invert
-			if(invert) {
-				red = 255 - red;
-				green = 255 - green;
-				blue = 255 - blue;
-			}
-
-			rgb[i] = qRgb(red, green, blue);
+			rgb[i] = qRgb(table[qRed(rgb[i])], table[qGreen(rgb[i])], table[qBlue(rgb[i])]);
 		}
 	}
 }
 
 ImageRenderer::ImageRenderer(const QString& filename) : DisplayRenderer(filename) {
-	m_pageCount = QImageReader(m_filename).imageCount();
+	m_image = DocumentCache::instance().image(filename);
 }
 
-QImage ImageRenderer::render(int page, double resolution) const {
+QImage ImageRenderer::renderPage(int page, double resolution, bool /*allowBitonal*/) const {
 	QImageReader reader(m_filename);
 	reader.jumpToImage(page - 1);
 	reader.setBackgroundColor(Qt::white);
 	reader.setScaledSize(reader.size() * resolution / 100.0);
-	return reader.read().convertToFormat(QImage::Format_RGB32);
+	return reader.read();
 }
 
-PDFRenderer::PDFRenderer(const QString& filename, const QByteArray& password) : DisplayRenderer(filename) {
-	m_document = Poppler::Document::load(filename);
-	if(m_document) {
-		if(m_document->isLocked()) {
-			m_document->unlock(password, password);
-		}
+QImage ImageRenderer::renderPageRegion(int page, double resolution, const QRect& region) const {
+	QImageReader reader(m_filename);
+	reader.jumpToImage(page - 1);
+	reader.setBackgroundColor(Qt::white);
+	if(reader.supportsOption(QImageIOHandler::ScaledClipRect)) {
+		reader.setScaledSize(reader.size() * resolution / 100.0);
+		reader.setScaledClipRect(region);
+		return reader.read();
+	}
+	// Other formats decode the entire page, which is kept for the following regions
+	QMutexLocker locker(&m_regionMutex);
+	if(page != m_regionPage || resolution != m_regionResolution) {
+		m_regionImage = renderPage(page, resolution, false);
+		m_regionPage = page;
+		m_regionResolution = resolution;
+	}
+	return m_regionImage.copy(region);
+}
 
-		m_document->setRenderHint(Poppler::Document::Antialiasing);
-		m_document->setRenderHint(Poppler::Document::TextAntialiasing);
+QSize ImageRenderer::pageSize(int page, double resolution) const {
+	QMutexLocker locker(&m_image->mutex);
+	auto it = m_image->pageSizes.find(page - 1);
+	if(it == m_image->pageSizes.end()) {
+		QImageReader reader(m_filename);
+		reader.jumpToImage(page - 1);
+		it = m_image->pageSizes.insert(page - 1, reader.size());
 	}
+	return it.value() * resolution / 100.0;
 }
 
-PDFRenderer::~PDFRenderer() {
-	delete m_document;
+PDFRenderer::PDFRenderer(const QString& filename, const QByteArray& password) : DisplayRenderer(filename) {
+	m_pdf = DocumentCache::instance().pdf(filename, password);
 }
 
-QImage PDFRenderer::render(int page, double resolution) const {
-	if(!m_document) {
+QImage PDFRenderer::renderPage(int page, double resolution, bool /*allowBitonal*/) const {
+	if(!m_pdf->document) {
 		return QImage();
 	}
-	m_mutex.lock();
-	Poppler::Page* poppage = m_document->page(page - 1);
-	m_mutex.unlock();
+	m_pdf->mutex.lock();
+	Poppler::Page* poppage = m_pdf->document->page(page - 1);
+	m_pdf->mutex.unlock();
 	QImage image = poppage->renderToImage(resolution, resolution);
 	delete poppage;
-	return image.convertToFormat(QImage::Format_RGB32);
+	return image;
+}
+
+QImage PDFRenderer::renderPageRegion(int page, double resolution, const QRect& region) const {
+	if(!m_pdf->document) {
+		return QImage();
+	}
+	m_pdf->mutex.lock();
+	Poppler::Page* poppage = m_pdf->document->page(page - 1);
+	m_pdf->mutex.unlock();
+	QImage image = poppage->renderToImage(resolution, resolution, region.x(), region.y(), region.width(), region.height());
+	delete poppage;
+	return image;
+}
+
+QSize PDFRenderer::pageSize(int page, double resolution) const {
+	if(!m_pdf->document) {
+		return QSize();
+	}
+	m_pdf->mutex.lock();
+	Poppler::Page* poppage = m_pdf->document->page(page - 1);
+	m_pdf->mutex.unlock();
+	// As the image size computed by renderToImage
+	QSizeF size = poppage->pageSizeF() * resolution / 72.0;
+	delete poppage;
+	return QSize(std::ceil(size.width()), std::ceil(size.height()));
 }
 
 int PDFRenderer::getNPages() const {
-	return m_document ? m_document->numPages() : 1;
+	QMutexLocker locker(&m_pdf->mutex);
+	return m_pdf->document ? m_pdf->document->numPages() : 1;
 }
 
 DJVURenderer::DJVURenderer(const QString& filename) : DisplayRenderer(filename) {
-	m_djvu = new DjVuDocument();
-	m_djvu->openFile(filename);
+	m_djvu = DocumentCache::instance().djvu(filename);
+}
+
+QImage DJVURenderer::renderPage(int page, double resolution, bool allowBitonal) const {
+	return m_djvu->document.image(page, resolution, allowBitonal);
 }
 
-DJVURenderer::~DJVURenderer() {
-	delete m_djvu;
+QImage DJVURenderer::renderPageRegion(int page, double resolution, const QRect& region) const {
+	return m_djvu->document.image(page, resolution, false, region);
 }
 
-QImage DJVURenderer::render(int page, double resolution) const {
-	return m_djvu->image(page, resolution);
+QSize DJVURenderer::pageSize(int page, double resolution) const {
+	return m_djvu->document.pageSize(page, resolution);
 }
 
 int DJVURenderer::getNPages() const {
-	return m_djvu->pageCount();
+	return m_djvu->document.pageCount();
 }
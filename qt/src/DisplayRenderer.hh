@@ -21,63 +21,93 @@
 #define DISPLAYRENDERER_HH
 
 #include <QByteArray>
+#include <QRect>
 #include <QString>
 #include <QMutex>
+#include <memory>
 
-class DjVuDocument;
+#include "DocumentCache.hh"
 
 class QImage;
-namespace Poppler {
-class Document;
-}
 
 class DisplayRenderer {
 public:
+	static DisplayRenderer* create(const QString& filename, const QByteArray& password);
+	static int defaultResolution(const QString& filename);
+	// Whether the resolution of the file is the dpi at which a document is rendered, rather than the scale in percent of an image
+	static bool isDocument(const QString& filename);
+
 	DisplayRenderer(const QString& filename) : m_filename(filename) {}
 	virtual ~DisplayRenderer() {}
-	virtual QImage render(int page, double resolution) const = 0;
+	// Renders the page as RGB32 image
+	QImage render(int page, double resolution) const;
+	// Renders the page in the most compact format tesseract accepts, see Utils::ocrImage,
+	// i.e. with 1 bit per pixel for bitonal and 8 bits per pixel for grayscale pages
+	QImage renderNative(int page, double resolution) const;
+	// Renders the given rectangle of the page at the given resolution as RGB32 image
+	QImage renderRegion(int page, double resolution, const QRect& region) const;
+	// Size of the page rendered at the given resolution, without rendering it
+	virtual QSize pageSize(int page, double resolution) const = 0;
 	virtual int getNPages() const = 0;
+	const QString& getFilename() const {
+		return m_filename;
+	}
 
+	// Adjusts an RGB32 image or an image in a format returned by renderNative
 	void adjustImage(QImage& image, int brightness, int contrast, bool invert) const;
 
 protected:
 	QString m_filename;
+
+	// Renders the page in the format which is cheapest to obtain from the source. Bitonal pages
+	// may only be rendered with one bit per pixel if allowBitonal is set.
+	virtual QImage renderPage(int page, double resolution, bool allowBitonal) const = 0;
+	virtual QImage renderPageRegion(int page, double resolution, const QRect& region) const = 0;
 };
 
 class ImageRenderer : public DisplayRenderer {
 public:
 	ImageRenderer(const QString& filename) ;
-	QImage render(int page, double resolution) const override;
+	QSize pageSize(int page, double resolution) const override;
 	int getNPages() const override {
-		return m_pageCount;
+		return m_image->pageCount;
 	}
 private:
-	int m_pageCount;
+	std::shared_ptr<DocumentCache::ImageHandle> m_image;
+	// Last page decoded to render regions of a format which cannot decode regions
+	mutable QMutex m_regionMutex;
+	mutable QImage m_regionImage;
+	mutable int m_regionPage = -1;
+	mutable double m_regionResolution = -1.;
+
+	QImage renderPage(int page, double resolution, bool allowBitonal) const override;
+	QImage renderPageRegion(int page, double resolution, const QRect& region) const override;
 };
 
 class PDFRenderer : public DisplayRenderer {
 public:
 	PDFRenderer(const QString& filename, const QByteArray& password);
-	~PDFRenderer();
-	QImage render(int page, double resolution) const override;
+	QSize pageSize(int page, double resolution) const override;
 	int getNPages() const override;
 
 private:
-	Poppler::Document* m_document;
-	mutable QMutex m_mutex;
+	std::shared_ptr<DocumentCache::PdfHandle> m_pdf;
+
+	QImage renderPage(int page, double resolution, bool allowBitonal) const override;
+	QImage renderPageRegion(int page, double resolution, const QRect& region) const override;
 };
 
 class DJVURenderer : public DisplayRenderer {
 public:
 	DJVURenderer(const QString& filename);
-	~DJVURenderer();
-	QImage render(int page, double resolution) const override;
+	QSize pageSize(int page, double resolution) const override;
 	int getNPages() const override;
 
 private:
-	DjVuDocument* m_djvu;
+	std::shared_ptr<DocumentCache::DjVuHandle> m_djvu;
 
-	mutable QMutex m_mutex;
+	QImage renderPage(int page, double resolution, bool allowBitonal) const override;
+	QImage renderPageRegion(int page, double resolution, const QRect& region) const override;
 };
 
 #endif // IMAGERENDERER_HH
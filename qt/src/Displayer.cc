@@ -17,10 +17,14 @@
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "CpuBudget.hh"
 #include "MainWindow.hh"
 #include "Displayer.hh"
 #include "DisplayRenderer.hh"
+#include "PagePrefetcher.hh"
+#include "RenderCache.hh"
 #include "SourceManager.hh"
+#include "TiledPageItem.hh"
 #include "Utils.hh"
 
 #include <cmath>
@@ -33,6 +37,10 @@
 #include <QWheelEvent>
 
 
+// Pages with more pixels are displayed as tiles over a preview of at most PREVIEW_SIZE pixels per side
+static const qint64 TILED_PAGE_PIXELS = 40 * 1000 * 1000;
+static const int PREVIEW_SIZE = 2048;
+
 class GraphicsScene : public QGraphicsScene {
 public:
 	using QGraphicsScene::QGraphicsScene;
@@ -53,6 +61,7 @@ Displayer::Displayer(const UI_MainWindow& _ui, QWidget* parent)
 	: QGraphicsView(parent), ui(_ui), m_scaleThread(std::bind(&Displayer::scaleThread, this)) {
 	m_scene = new GraphicsScene();
 	setScene(m_scene);
+	m_prefetcher = new PagePrefetcher();
 	setBackgroundBrush(Qt::gray);
 	setRenderHint(QPainter::Antialiasing);
 
@@ -85,6 +94,7 @@ Displayer::Displayer(const UI_MainWindow& _ui, QWidget* parent)
 
 Displayer::~Displayer() {
 	setSources(QList<Source*>());
+	delete m_prefetcher;
 	delete m_scene;
 }
 
@@ -94,6 +104,7 @@ bool Displayer::setSources(QList<Source*> sources) {
 	}
 
 	m_scaleTimer.stop();
+	m_prefetcher->cancel();
 	if(m_scaleThread.isRunning()) {
 		sendScaleRequest({ScaleRequest::Abort});
 		sendScaleRequest({ScaleRequest::Quit});
@@ -106,6 +117,8 @@ bool Displayer::setSources(QList<Source*> sources) {
 		m_tool->reset();
 	}
 	m_renderTimer.stop();
+	delete m_tileItem;
+	m_tileItem = nullptr;
 	m_scene->removeItem(m_imageItem);
 	delete m_renderer;
 	m_renderer = nullptr;
@@ -113,6 +126,8 @@ bool Displayer::setSources(QList<Source*> sources) {
 	m_sources.clear();
 	m_pageMap.clear();
 	m_pixmap = QPixmap();
+	m_pixmapScale = 1.;
+	m_pageSize = QSize();
 	m_imageItem = nullptr;
 	ui.actionBestFit->setChecked(true);
 	ui.actionPage->setVisible(false);
@@ -142,14 +157,7 @@ bool Displayer::setSources(QList<Source*> sources) {
 
 	int page = 0;
 	for(Source* source : m_sources) {
-		DisplayRenderer* renderer;
-		if(source->path.endsWith(".pdf", Qt::CaseInsensitive)) {
-			renderer = new PDFRenderer(source->path, source->password);
-		} else if(source->path.endsWith(".djvu", Qt::CaseInsensitive)) {
-			renderer = new DJVURenderer(source->path);
-		} else {
-			renderer = new ImageRenderer(source->path);
-		}
+		DisplayRenderer* renderer = DisplayRenderer::create(source->path, source->password);
 		source->angle.resize(renderer->getNPages());
 		for(int iPage = 1, nPages = renderer->getNPages(); iPage <= nPages; ++iPage) {
 			m_pageMap.insert(++page, qMakePair(source, iPage));
@@ -225,15 +233,9 @@ bool Displayer::renderImage() {
 		}
 		m_scaleRequests.clear();
 		delete m_renderer;
-		if(source->path.endsWith(".pdf", Qt::CaseInsensitive)) {
-			m_renderer = new PDFRenderer(source->path, source->password);
-			if(source->resolution == -1) { source->resolution = 300; }
-		} else if(source->path.endsWith(".djvu", Qt::CaseInsensitive)) {
-			m_renderer = new DJVURenderer(source->path);
-			if(source->resolution == -1) { source->resolution = 300; }
-		} else {
-			m_renderer = new ImageRenderer(source->path);
-			if(source->resolution == -1) { source->resolution = 100; }
+		m_renderer = DisplayRenderer::create(source->path, source->password);
+		if(source->resolution == -1) {
+			source->resolution = DisplayRenderer::defaultResolution(source->path);
 		}
 
 		Utils::setSpinBlocked(ui.spinBoxResolution, source->resolution);
@@ -268,26 +270,77 @@ bool Displayer::renderImage() {
 
 	// Render new image
 	sendScaleRequest({ScaleRequest::Abort});
-	QImage image = m_renderer->render(m_currentSource->page, m_currentSource->resolution);
-	if(image.isNull()) {
-		return false;
+	QImage image;
+	{
+		CpuBudget::Interactive interactive;
+		m_pageSize = m_renderer->pageSize(m_currentSource->page, m_currentSource->resolution);
+		m_pixmapScale = 1.;
+		if(qint64(m_pageSize.width()) * m_pageSize.height() > TILED_PAGE_PIXELS) {
+			m_pixmapScale = double(PREVIEW_SIZE) / std::max(m_pageSize.width(), m_pageSize.height());
+		} else if(!m_pageSize.isEmpty() && MAIN->getConfig()->progressiveRendering()) {
+			// The page is shown at the scale of the view first, the full resolution is rendered on demand
+			QRectF bb = getSceneBoundingRect(m_pageSize, ui.spinBoxRotation->value());
+			double fit = std::min(viewport()->width() / bb.width(), viewport()->height() / bb.height());
+			// Bounded by the smallest zoom, the viewport is empty before the window is shown
+			m_pixmapScale = qBound(0.05, ui.actionBestFit->isChecked() ? fit : m_scale, 1.);
+		}
+		image = MAIN->getRenderCache()->render(*m_renderer, m_currentSource->page, m_pixmapScale * m_currentSource->resolution, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert);
+		if(image.isNull()) {
+			return false;
+		}
+		if(m_pixmapScale == 1.) {
+			m_pageSize = image.size();
+		}
 	}
-	m_renderer->adjustImage(image, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert);
 	m_pixmap = QPixmap::fromImage(image);
-	m_imageItem->setPixmap(m_pixmap);
-	m_imageItem->setScale(1.);
-	m_imageItem->setTransformOriginPoint(m_imageItem->boundingRect().center());
-	m_imageItem->setPos(m_imageItem->pos() - m_imageItem->sceneBoundingRect().center());
+	if(m_pixmapScale < 1.) {
+		if(!m_tileItem) {
+			m_tileItem = new TiledPageItem(m_imageItem);
+		}
+		m_tileItem->setPage(getRenderSettings(getCurrentPage()), m_pageSize, m_pixmapScale);
+	} else {
+		delete m_tileItem;
+		m_tileItem = nullptr;
+	}
+	setPixmap(m_pixmap, m_pixmapScale);
 	m_scene->setSceneRect(m_imageItem->sceneBoundingRect());
 	centerOn(sceneRect().center());
 	setAngle(ui.spinBoxRotation->value());
-	if(m_scale < 1.0) {
-		m_pendingScaleRequest = {ScaleRequest::Scale, m_scale, m_currentSource->resolution, m_currentSource->page, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert};
-		m_scaleTimer.start(100);
-	}
+	updateScaledImage();
+	prefetchPages();
 	return true;
 }
 
+void Displayer::prefetchPages() {
+	// Replaces the pages queued for the previous page or settings
+	QList<RenderSettings> pages;
+	RenderCache* cache = MAIN->getRenderCache();
+	int nPages = MAIN->getConfig()->prefetchPages();
+	if(nPages == 0 || !cache->enabled()) {
+		m_prefetcher->cancel();
+		return;
+	}
+	// The prefetched pages may take up half of the cache, the other half remains for the visited pages.
+	// Their size is estimated by the one of the displayed page, adjusted pages are cached twice.
+	qint64 pageSize = qint64(m_pixmap.width()) * m_pixmap.height() * 4;
+	if(m_currentSource->brightness != 0 || m_currentSource->contrast != 0 || m_currentSource->invert) {
+		pageSize *= 2;
+	}
+	qint64 budget = cache->maxSize() / 2;
+	int current = getCurrentPage();
+	for(int i = 1; i <= nPages; ++i) {
+		// Forward first, since pages are mostly read in order
+		for(int page : {current + i, current - i}) {
+			if(m_pageMap.contains(page) && budget >= pageSize) {
+				pages.append(getRenderSettings(page));
+				budget -= pageSize;
+			}
+		}
+	}
+	// At the scale of the displayed pixmap, which matches the neighbouring pages of the same size
+	m_prefetcher->prefetch(pages, m_pixmapScale);
+}
+
 int Displayer::getCurrentPage() const {
 	return ui.spinBoxPage->value();
 }
@@ -309,6 +362,24 @@ QString Displayer::getCurrentImage(int& page) const {
 	return m_pageMap[ui.spinBoxPage->value()].first ? m_pageMap[ui.spinBoxPage->value()].first->path : "";
 }
 
+Displayer::RenderSettings Displayer::getRenderSettings(int page) const {
+	RenderSettings settings;
+	auto it = m_pageMap.find(page);
+	if(it == m_pageMap.end() || !it.value().first) {
+		return settings;
+	}
+	const Source* source = it.value().first;
+	settings.file = source->path;
+	settings.password = source->password;
+	settings.page = it.value().second;
+	settings.resolution = source->resolution == -1 ? DisplayRenderer::defaultResolution(source->path) : source->resolution;
+	settings.brightness = source->brightness;
+	settings.contrast = source->contrast;
+	settings.invert = source->invert;
+	settings.angle = source->angle[settings.page - 1];
+	return settings;
+}
+
 bool Displayer::hasMultipleOCRAreas() {
 	return m_tool->hasMultipleOCRAreas();
 }
@@ -317,6 +388,10 @@ QList<QImage> Displayer::getOCRAreas() {
 	return m_tool->getOCRAreas();
 }
 
+QList<QRectF> Displayer::getOCRAreaRects() const {
+	return m_tool->getOCRAreaRects();
+}
+
 bool Displayer::allowAutodetectOCRAreas() const {
 	return m_tool->allowAutodetectOCRAreas();
 }
@@ -357,15 +432,7 @@ void Displayer::setZoom(Zoom action, ViewportAnchor anchor) {
 	QTransform t;
 	t.scale(m_scale, m_scale);
 	setTransform(t);
-	if(m_scale < 1.0) {
-		m_pendingScaleRequest = {ScaleRequest::Scale, m_scale, m_currentSource->resolution, m_currentSource->page, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert};
-		m_scaleTimer.start(100);
-	} else {
-		m_imageItem->setPixmap(m_pixmap);
-		m_imageItem->setScale(1.);
-		m_imageItem->setTransformOriginPoint(m_imageItem->boundingRect().center());
-		m_imageItem->setPos(m_imageItem->pos() - m_imageItem->sceneBoundingRect().center());
-	}
+	updateScaledImage();
 	setUpdatesEnabled(true);
 	update();
 }
@@ -493,22 +560,74 @@ QImage Displayer::getImage(const QRectF& rect) {
 	QTransform t;
 	t.translate(-rect.x(), -rect.y());
 	t.rotate(ui.spinBoxRotation->value());
-	t.translate(-0.5 * m_pixmap.width(), -0.5 * m_pixmap.height());
+	t.translate(-0.5 * m_pageSize.width(), -0.5 * m_pageSize.height());
 	painter.setTransform(t);
-	painter.drawPixmap(0, 0, m_pixmap);
+	if(m_pixmapScale < 1.) {
+		painter.drawImage(0, 0, fullImage());
+	} else {
+		painter.drawPixmap(0, 0, m_pixmap);
+	}
 	return image;
 }
 
+QImage Displayer::getPageImage(int resolution) const {
+	int curResolution = getCurrentResolution();
+	if(resolution >= curResolution) {
+		return fullImage();
+	}
+	double scale = double(resolution) / curResolution;
+	if(scale > m_pixmapScale) {
+		// More detailed than the preview of a tiled page
+		CpuBudget::Interactive interactive;
+		return MAIN->getRenderCache()->render(*m_renderer, m_currentSource->page, resolution, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert);
+	}
+	return m_pixmap.scaled(qRound(m_pageSize.width() * scale), qRound(m_pageSize.height() * scale), Qt::IgnoreAspectRatio, Qt::SmoothTransformation).toImage();
+}
+
+QImage Displayer::fullImage() const {
+	if(m_pixmapScale == 1.) {
+		return m_pixmap.toImage();
+	}
+	CpuBudget::Interactive interactive;
+	return MAIN->getRenderCache()->render(*m_renderer, m_currentSource->page, m_currentSource->resolution, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert);
+}
+
+QImage Displayer::getImage(const QImage& image, double angle, const QRectF& rect) {
+	bool native = image.format() != QImage::Format_RGB32;
+	if(native && std::fmod(angle, 360.) == 0.) {
+		// Plain crop, which keeps the format. Pixels outside the image are zero, i.e. black as below.
+		return image.copy(rect.translated(0.5 * image.width(), 0.5 * image.height()).toRect());
+	}
+	QImage area(rect.width(), rect.height(), QImage::Format_RGB32);
+	area.fill(Qt::black);
+	QPainter painter(&area);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	QTransform t;
+	t.translate(-rect.x(), -rect.y());
+	t.rotate(angle);
+	t.translate(-0.5 * image.width(), -0.5 * image.height());
+	painter.setTransform(t);
+	painter.drawImage(0, 0, image);
+	painter.end();
+	// Return the area in the compact format of the image, see Utils::ocrImage
+	if(native && image.depth() == 1) {
+		return Utils::ocrImage(area.convertToFormat(QImage::Format_Mono, Qt::ThresholdDither));
+	}
+	return native ? Utils::ocrImage(area) : area;
+}
+
+QRectF Displayer::getSceneBoundingRect(const QSize& size, double angle) {
+	QRectF rect(size.width() * -0.5, size.height() * -0.5, size.width(), size.height());
+	QTransform transform;
+	transform.rotate(angle);
+	return transform.mapRect(rect);
+}
+
 QRectF Displayer::getSceneBoundingRect() const {
 	// We cannot use m_imageItem->sceneBoundingRect() since its pixmap
 	// can currently be downscaled and therefore have slightly different
 	// proportions.
-	int width = m_pixmap.width();
-	int height = m_pixmap.height();
-	QRectF rect(width * -0.5, height * -0.5, width, height);
-	QTransform transform;
-	transform.rotate(ui.spinBoxRotation->value());
-	return transform.mapRect(rect);
+	return getSceneBoundingRect(m_pageSize, ui.spinBoxRotation->value());
 }
 
 void Displayer::scaleTimerElapsed() {
@@ -534,8 +653,10 @@ void Displayer::scaleThread() {
 			break;
 		} else if(req.type == ScaleRequest::Scale) {
 			m_scaleMutex.unlock();
-			QImage image = m_renderer->render(req.page, req.scale * req.resolution);
+			CpuBudget::Interactive interactive;
+			QImage image = MAIN->getRenderCache()->render(*m_renderer, req.page, req.scale * req.resolution, req.brightness, req.contrast, req.invert);
 			if(image.isNull()) {
+				m_scaleMutex.lock();
 				continue;
 			}
 
@@ -546,16 +667,7 @@ void Displayer::scaleThread() {
 			}
 			m_scaleMutex.unlock();
 
-			m_renderer->adjustImage(image, req.brightness, req.contrast, req.invert);
-
-			m_scaleMutex.lock();
-			if(!m_scaleRequests.isEmpty() && m_scaleRequests.first().type == ScaleRequest::Abort) {
-				m_scaleRequests.removeFirst();
-				continue;
-			}
-			m_scaleMutex.unlock();
-
-			QMetaObject::invokeMethod(this, "setScaledImage", Qt::BlockingQueuedConnection, Q_ARG(QImage, image), Q_ARG(double, m_scale));
+			QMetaObject::invokeMethod(this, "setScaledImage", Qt::BlockingQueuedConnection, Q_ARG(QImage, image), Q_ARG(double, req.scale));
 			m_scaleMutex.lock();
 		}
 	}
@@ -566,15 +678,43 @@ void Displayer::setScaledImage(const QImage& image, double scale) {
 	m_scaleMutex.lock();
 	if(!m_scaleRequests.isEmpty() && m_scaleRequests.first().type == ScaleRequest::Abort) {
 		m_scaleRequests.removeFirst();
+	} else if(scale == 1.) {
+		// The full resolution of a progressively rendered page, which replaces its preview
+		m_pixmap = QPixmap::fromImage(image);
+		m_pixmapScale = 1.;
+		setPixmap(m_pixmap, m_pixmapScale);
 	} else {
-		m_imageItem->setPixmap(QPixmap::fromImage(image));
-		m_imageItem->setScale(1.0 / scale);
-		m_imageItem->setTransformOriginPoint(m_imageItem->boundingRect().center());
-		m_imageItem->setPos(m_imageItem->pos() - m_imageItem->sceneBoundingRect().center());
+		setPixmap(QPixmap::fromImage(image), scale);
 	}
 	m_scaleMutex.unlock();
 }
 
+void Displayer::updateScaledImage() {
+	// The pixmap shows the page at the scale of the view, up to its full resolution.
+	// The tiles of a large page show its details beyond the preview.
+	double scale = std::min(1., m_scale);
+	if(m_tileItem) {
+		scale = std::min(scale, m_pixmapScale);
+	}
+	if(std::abs(scale - m_pixmapScale) > 0.01 * m_pixmapScale) {
+		m_pendingScaleRequest = {ScaleRequest::Scale, scale, m_currentSource->resolution, m_currentSource->page, m_currentSource->brightness, m_currentSource->contrast, m_currentSource->invert};
+		m_scaleTimer.start(100);
+	} else {
+		setPixmap(m_pixmap, m_pixmapScale);
+	}
+}
+
+void Displayer::setPixmap(const QPixmap& pixmap, double scale) {
+	m_imageItem->setPixmap(pixmap);
+	m_imageItem->setScale(1.0 / scale);
+	m_imageItem->setTransformOriginPoint(m_imageItem->boundingRect().center());
+	m_imageItem->setPos(m_imageItem->pos() - m_imageItem->sceneBoundingRect().center());
+	if(m_tileItem) {
+		// The tiles are placed in pixels of the page
+		m_tileItem->setScale(scale);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void DisplayerSelection::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) {
@@ -33,13 +33,32 @@
 
 class DisplayerTool;
 class DisplayRenderer;
+class PagePrefetcher;
 class Source;
+class TiledPageItem;
 class UI_MainWindow;
 class GraphicsScene;
 
 class Displayer : public QGraphicsView {
 	Q_OBJECT
 public:
+	// Everything needed to render a page independently of the current display state
+	struct RenderSettings {
+		QString file;
+		QByteArray password;
+		int page = -1;
+		int resolution = -1;
+		int brightness = 0;
+		int contrast = 0;
+		bool invert = false;
+		double angle = 0.;
+	};
+
+	// Extracts the specified scene rectangle of the image rotated by the given angle. The area of an RGB32 image
+	// is an RGB32 image, areas of images in other formats are returned in the formats of Utils::ocrImage.
+	static QImage getImage(const QImage& image, double angle, const QRectF& rect);
+	static QRectF getSceneBoundingRect(const QSize& size, double angle);
+
 	Displayer(const UI_MainWindow& _ui, QWidget* parent = nullptr);
 	~Displayer();
 	void setTool(DisplayerTool* tool) {
@@ -55,11 +74,15 @@ public:
 		return m_scale;
 	}
 	QString getCurrentImage(int& page) const;
+	RenderSettings getRenderSettings(int page) const;
 	QImage getImage(const QRectF& rect);
+	// Returns the unrotated current page scaled down to the given resolution
+	QImage getPageImage(int resolution) const;
 	QRectF getSceneBoundingRect() const;
 	QPointF mapToSceneClamped(const QPoint& p) const;
 	bool hasMultipleOCRAreas();
 	QList<QImage> getOCRAreas();
+	QList<QRectF> getOCRAreaRects() const;
 	bool allowAutodetectOCRAreas() const;
 	void setCursor(const QCursor& cursor) {
 		viewport()->setCursor(cursor);
@@ -80,8 +103,13 @@ private:
 	QMap<int, QPair<Source*, int>> m_pageMap;
 	Source* m_currentSource = nullptr;
 	DisplayRenderer* m_renderer = nullptr;
+	PagePrefetcher* m_prefetcher;
 	QPixmap m_pixmap;
+	// The pixmap shows the page at this scale, less than one for the preview of a page displayed as tiles or rendered progressively
+	double m_pixmapScale = 1.;
+	QSize m_pageSize;
 	QGraphicsPixmapItem* m_imageItem = nullptr;
+	TiledPageItem* m_tileItem = nullptr;
 	double m_scale = 1.0;
 	DisplayerTool* m_tool = nullptr;
 	QPoint m_panPos;
@@ -95,6 +123,12 @@ private:
 	void wheelEvent(QWheelEvent* event) override;
 
 	void setZoom(Zoom action, QGraphicsView::ViewportAnchor anchor = QGraphicsView::AnchorViewCenter);
+	void prefetchPages();
+	void setPixmap(const QPixmap& pixmap, double scale);
+	// Displays the pixmap, or requests the page at the scale of the view from the scale thread
+	void updateScaledImage();
+	// The current page at its resolution, which is rendered on demand for a page displayed as tiles
+	QImage fullImage() const;
 
 	struct ScaleRequest {
 		enum Request { Scale, Abort, Quit } type;
@@ -158,6 +192,10 @@ public:
 	virtual void resolutionChanged(double /*factor*/) {}
 	virtual void rotationChanged(double /*delta*/) {}
 	virtual QList<QImage> getOCRAreas() = 0;
+	// The areas to recognize in scene coordinates, an empty list denotes the entire page
+	virtual QList<QRectF> getOCRAreaRects() const {
+		return QList<QRectF>();
+	}
 	virtual bool hasMultipleOCRAreas() const {
 		return false;
 	}
@@ -18,13 +18,15 @@
  */
 
 #include "DisplayerToolSelect.hh"
+#include "Deskew.hh"
 #include "Displayer.hh"
+#include "EngineCache.hh"
 #include "FileDialogs.hh"
 #include "MainWindow.hh"
 #include "Recognizer.hh"
 #include "Utils.hh"
 
-#include <cmath>
+#include <algorithm>
 #define USE_STD_NAMESPACE
 #include <tesseract/baseapi.h>
 #undef USE_STD_NAMESPACE
@@ -32,8 +34,11 @@
 #include <QLabel>
 #include <QMenu>
 #include <QMouseEvent>
+#include <QMutexLocker>
 #include <QStyle>
 
+// Text blocks and skew are reliably detected at this resolution, at a fraction of the cost of a full resolution page
+static const int LAYOUT_RESOLUTION = 100;
 
 DisplayerToolSelect::DisplayerToolSelect(Displayer* displayer, QObject* parent)
 	: DisplayerTool(displayer, parent) {
@@ -93,6 +98,14 @@ void DisplayerToolSelect::rotationChanged(double delta) {
 	}
 }
 
+QList<QRectF> DisplayerToolSelect::getOCRAreaRects() const {
+	QList<QRectF> rects;
+	for(const NumberedDisplayerSelection* sel : m_selections) {
+		rects.append(sel->rect());
+	}
+	return rects;
+}
+
 QList<QImage> DisplayerToolSelect::getOCRAreas() {
 	QList<QImage> images;
 	if(m_selections.empty()) {
@@ -142,70 +155,76 @@ void DisplayerToolSelect::updateRecognitionModeLabel() {
 	MAIN->getRecognizer()->setRecognizeMode(m_selections.isEmpty() ? _("Recognize all") : _("Recognize selection"));
 }
 
-void DisplayerToolSelect::autodetectLayout(bool noDeskew) {
-	clearSelections();
+int DisplayerToolSelect::layoutResolution(int resolution) {
+	return std::min(resolution, LAYOUT_RESOLUTION);
+}
 
-	double avgDeskew = 0.0;
-	int nDeskew = 0;
+QList<QRectF> DisplayerToolSelect::analyzeLayout(const QImage& proxy, int proxyResolution, int resolution, double angle) {
+	QImage image = Displayer::getImage(proxy, angle, Displayer::getSceneBoundingRect(proxy.size(), angle));
+	double scale = double(resolution) / proxyResolution;
 	QList<QRectF> rects;
-	QImage img = m_displayer->getImage(m_displayer->getSceneBoundingRect());
-
-	// Perform layout analysis
-	Utils::busyTask([this, &nDeskew, &avgDeskew, &rects, &img] {
-		QByteArray current = setlocale(LC_ALL, NULL);
-		setlocale(LC_ALL, "C");
-		tesseract::TessBaseAPI tess;
-		tess.InitForAnalysePage();
-		setlocale(LC_ALL, current.constData());
-		tess.SetPageSegMode(tesseract::PSM_AUTO_ONLY);
-		tess.SetImage(img.bits(), img.width(), img.height(), 4, img.bytesPerLine());
-		tesseract::PageIterator* it = tess.AnalyseLayout();
-		if(it && !it->Empty(tesseract::RIL_BLOCK)) {
-			do {
-				int x1, y1, x2, y2;
-				tesseract::Orientation orient;
-				tesseract::WritingDirection wdir;
-				tesseract::TextlineOrder tlo;
-				float deskew;
-				it->BoundingBox(tesseract::RIL_BLOCK, &x1, &y1, &x2, &y2);
-				it->Orientation(&orient, &wdir, &tlo, &deskew);
-				avgDeskew += deskew;
-				++nDeskew;
-				float width = x2 - x1, height = y2 - y1;
-				if(width > 10 && height > 10) {
-					rects.append(QRectF(x1 - 0.5 * img.width(), y1 - 0.5 * img.height(), width, height));
-				}
-			} while(it->Next(tesseract::RIL_BLOCK));
+	// Runs concurrently on the renderer threads of the recognizer
+	QMutexLocker locker(&EngineCache::initMutex());
+	QByteArray current = setlocale(LC_ALL, NULL);
+	setlocale(LC_ALL, "C");
+	tesseract::TessBaseAPI tess;
+	tess.InitForAnalysePage();
+	setlocale(LC_ALL, current.constData());
+	locker.unlock();
+	tess.SetPageSegMode(tesseract::PSM_AUTO_ONLY);
+	Utils::setOcrImage(tess, image);
+	tess.SetSourceResolution(proxyResolution);
+	tesseract::PageIterator* it = tess.AnalyseLayout();
+	if(it && !it->Empty(tesseract::RIL_BLOCK)) {
+		do {
+			int x1, y1, x2, y2;
+			it->BoundingBox(tesseract::RIL_BLOCK, &x1, &y1, &x2, &y2);
+			float width = x2 - x1, height = y2 - y1;
+			if(width > 10 && height > 10) {
+				rects.append(QRectF((x1 - 0.5 * image.width()) * scale, (y1 - 0.5 * image.height()) * scale, width * scale, height * scale));
+			}
+		} while(it->Next(tesseract::RIL_BLOCK));
+	}
+	delete it;
+
+	// Merge overlapping rectangles
+	for(int i = rects.size(); i-- > 1;) {
+		for(int j = i; j-- > 0;) {
+			if(rects[j].intersects(rects[i])) {
+				rects[j] = rects[j].united(rects[i]);
+				rects.removeAt(i);
+				break;
+			}
 		}
-		delete it;
+	}
+	return rects;
+}
+
+void DisplayerToolSelect::autodetectLayout() {
+	clearSelections();
+
+	double angle = m_displayer->getCurrentAngle();
+	int resolution = m_displayer->getCurrentResolution();
+	int proxyResolution = layoutResolution(resolution);
+	QImage proxy = m_displayer->getPageImage(proxyResolution);
+	QList<QRectF> rects;
+
+	// Straighten the page, then perform layout analysis
+	Utils::busyTask([&] {
+		angle = Deskew::estimateAngle(proxy, angle);
+		rects = analyzeLayout(proxy, proxyResolution, resolution, angle);
 		return true;
 	}, _("Performing layout analysis"));
 
-	// If a somewhat large deskew angle is detected, automatically rotate image and redetect layout,
-	// unless we already attempted to rotate (to prevent endless loops)
-	avgDeskew = qRound(((avgDeskew / nDeskew) / M_PI * 180.0) * 10.0) / 10.0;
-	if(std::abs(avgDeskew) > 0.1 && !noDeskew) {
-		double newangle = m_displayer->getCurrentAngle() - avgDeskew;
-		m_displayer->setup(nullptr, nullptr, &newangle);
-		autodetectLayout(true);
-	} else {
-		// Merge overlapping rectangles
-		for(int i = rects.size(); i-- > 1;) {
-			for(int j = i; j-- > 0;) {
-				if(rects[j].intersects(rects[i])) {
-					rects[j] = rects[j].united(rects[i]);
-					rects.removeAt(i);
-					break;
-				}
-			}
-		}
-		for(int i = 0, n = rects.size(); i < n; ++i) {
-			m_selections.append(new NumberedDisplayerSelection(this, 1 + i, rects[i].topLeft()));
-			m_selections.back()->setPoint(rects[i].bottomRight());
-			m_displayer->scene()->addItem(m_selections.back());
-		}
-		updateRecognitionModeLabel();
+	if(angle != m_displayer->getCurrentAngle()) {
+		m_displayer->setup(nullptr, nullptr, &angle);
 	}
+	for(int i = 0, n = rects.size(); i < n; ++i) {
+		m_selections.append(new NumberedDisplayerSelection(this, 1 + i, rects[i].topLeft()));
+		m_selections.back()->setPoint(rects[i].bottomRight());
+		m_displayer->scene()->addItem(m_selections.back());
+	}
+	updateRecognitionModeLabel();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
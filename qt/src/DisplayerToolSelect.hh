@@ -31,6 +31,12 @@ class NumberedDisplayerSelection;
 class DisplayerToolSelect : public DisplayerTool {
 	Q_OBJECT
 public:
+	// Resolution of the proxy image on which the layout of a page of the given resolution is analyzed
+	static int layoutResolution(int resolution);
+	// Analyzes the layout of the proxy of a page, rotated by angle. Returns the merged text blocks
+	// in scene coordinates of the page at its full resolution.
+	static QList<QRectF> analyzeLayout(const QImage& proxy, int proxyResolution, int resolution, double angle);
+
 	DisplayerToolSelect(Displayer* displayer, QObject* parent = 0);
 	~DisplayerToolSelect();
 	void mousePressEvent(QMouseEvent* event) override;
@@ -40,6 +46,7 @@ public:
 	void rotationChanged(double delta) override;
 
 	QList<QImage> getOCRAreas() override;
+	QList<QRectF> getOCRAreaRects() const override;
 	bool hasMultipleOCRAreas() const override {
 		return !m_selections.isEmpty();
 	}
@@ -63,7 +70,7 @@ private:
 	void reorderSelection(int oldNum, int newNum);
 	void saveSelection(NumberedDisplayerSelection* selection);
 	void updateRecognitionModeLabel();
-	void autodetectLayout(bool noDeskew = false);
+	void autodetectLayout();
 };
 
 class NumberedDisplayerSelection : public DisplayerSelection {
@@ -51,11 +51,15 @@ DjVuDocument::DjVuDocument() {
 	m_format = ddjvu_format_create( DDJVU_FORMAT_RGBMASK32, 4, formatmask );
 	ddjvu_format_set_row_order( m_format, 1 );
 	ddjvu_format_set_y_direction( m_format, 1 );
+	m_bitonalFormat = ddjvu_format_create( DDJVU_FORMAT_MSBTOLSB, 0, nullptr );
+	ddjvu_format_set_row_order( m_bitonalFormat, 1 );
+	ddjvu_format_set_y_direction( m_bitonalFormat, 1 );
 }
 
 DjVuDocument::~DjVuDocument() {
 	closeFile();
 	ddjvu_format_release( m_format );
+	ddjvu_format_release( m_bitonalFormat );
 	ddjvu_context_release( m_djvu_cxt );
 }
 
@@ -106,19 +110,30 @@ void DjVuDocument::closeFile() {
 	m_djvu_document = nullptr;
 }
 
-QImage DjVuDocument::image( int pageno, int resolution ) {
+QSize DjVuDocument::pageSize( int pageno, int resolution ) const {
+	if(pageno < 0 || pageno >= pageCount()) {
+		return QSize();
+	}
+	const DjVuDocument::Page& page = m_pages[pageno];
+	double scaleFactor = double(resolution) / double(page.dpi);
+	return QSize(page.width * scaleFactor, page.height * scaleFactor);
+}
+
+QImage DjVuDocument::image( int pageno, int resolution, bool allowBitonal, const QRect& region ) {
 	if(pageno < 0 || pageno >= pageCount()) {
 		return QImage();
 	}
 
 	const DjVuDocument::Page& page = m_pages[pageno];
 
+	m_mutex.lock();
 	ddjvu_page_t* djvupage = ddjvu_page_create_by_pageno( m_djvu_document, pageno );
 	// wait for the new page to be loaded
 	ddjvu_status_t sts;
 	while ( ( sts = ddjvu_page_decoding_status( djvupage ) ) < DDJVU_JOB_OK ) {
 		handle_ddjvu_messages( m_djvu_cxt, true );
 	}
+	m_mutex.unlock();
 
 	double scaleFactor = double(resolution) / double(page.dpi);
 	ddjvu_rect_t pagerect;
@@ -127,10 +142,32 @@ QImage DjVuDocument::image( int pageno, int resolution ) {
 	pagerect.w = page.width * scaleFactor;
 	pagerect.h = page.height * scaleFactor;
 	ddjvu_rect_t renderrect = pagerect;
-	QImage res_img( renderrect.w, renderrect.h, QImage::Format_RGB32 );
-	int res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char*)res_img.bits() );
-	if (!res) {
-		res_img.fill(Qt::white);
+	if ( region.isValid() ) {
+		QRect clipped = region.intersected( QRect( 0, 0, pagerect.w, pagerect.h ) );
+		if ( clipped.isEmpty() ) {
+			ddjvu_page_release( djvupage );
+			return QImage();
+		}
+		renderrect.x = clipped.x();
+		renderrect.y = clipped.y();
+		renderrect.w = clipped.width();
+		renderrect.h = clipped.height();
+	}
+	QImage res_img;
+	if ( allowBitonal && ddjvu_page_get_type( djvupage ) == DDJVU_PAGETYPE_BITONAL ) {
+		// Set bits are black
+		res_img = QImage( renderrect.w, renderrect.h, QImage::Format_Mono );
+		res_img.setColorTable( QVector<QRgb>() << qRgb( 255, 255, 255 ) << qRgb( 0, 0, 0 ) );
+		int res = ddjvu_page_render( djvupage, DDJVU_RENDER_BLACK, &pagerect, &renderrect, m_bitonalFormat, res_img.bytesPerLine(), (char*)res_img.bits() );
+		if (!res) {
+			res_img.fill(0);
+		}
+	} else {
+		res_img = QImage( renderrect.w, renderrect.h, QImage::Format_RGB32 );
+		int res = ddjvu_page_render( djvupage, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char*)res_img.bits() );
+		if (!res) {
+			res_img.fill(Qt::white);
+		}
 	}
 
 	ddjvu_page_release(djvupage);
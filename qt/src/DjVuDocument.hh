@@ -14,6 +14,7 @@
 #define DJVUDOCUMENT_HH
 
 #include <QImage>
+#include <QMutex>
 #include <QVector>
 
 typedef struct ddjvu_context_s    ddjvu_context_t;
@@ -27,7 +28,10 @@ public:
 
 	bool openFile( const QString& fileName );
 	void closeFile();
-	QImage image(int pageno, int resolution);
+	// Bitonal pages are rendered as 1 bit image if allowBitonal is set, all others as RGB32 image.
+	// A valid region restricts the rendering to that rectangle of the page at the given resolution.
+	QImage image(int pageno, int resolution, bool allowBitonal = false, const QRect& region = QRect());
+	QSize pageSize(int pageno, int resolution) const;
 	int pageCount() const {
 		return m_pages.size();
 	}
@@ -39,9 +43,12 @@ private:
 		int dpi;
 	};
 
+	// Serializes the message handling of the context, the renders of decoded pages run concurrently
+	QMutex m_mutex;
 	ddjvu_context_t* m_djvu_cxt = nullptr;
 	ddjvu_document_t* m_djvu_document = nullptr;
 	ddjvu_format_t* m_format = nullptr;
+	ddjvu_format_t* m_bitonalFormat = nullptr;
 	QVector<Page> m_pages;
 };
 
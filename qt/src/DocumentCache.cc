@@ -0,0 +1,102 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * DocumentCache.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <poppler-qt4.h>
+#else
+#include <poppler-qt5.h>
+#endif
+
+#include "DocumentCache.hh"
+
+// Documents kept open after their last handle was released
+static const int MAX_RECENT_DOCUMENTS = 4;
+
+DocumentCache::PdfHandle::~PdfHandle() {
+	delete document;
+}
+
+DocumentCache& DocumentCache::instance() {
+	static DocumentCache cache;
+	return cache;
+}
+
+template<class T>
+std::shared_ptr<T> DocumentCache::acquire(QHash<QString, std::weak_ptr<T>>& handles, const QString& file) {
+	QString key = QString("%1\n%2").arg(file).arg(QFileInfo(file).lastModified().toMSecsSinceEpoch());
+	QMutexLocker locker(&m_mutex);
+	std::shared_ptr<T> handle = handles.value(key).lock();
+	if(!handle) {
+		for(auto it = handles.begin(); it != handles.end();) {
+			if(it.value().expired()) {
+				it = handles.erase(it);
+			} else {
+				++it;
+			}
+		}
+		handle = std::make_shared<T>();
+		handles.insert(key, handle);
+	}
+	m_recent.removeOne(handle);
+	m_recent.prepend(handle);
+	while(m_recent.size() > MAX_RECENT_DOCUMENTS) {
+		m_recent.removeLast();
+	}
+	return handle;
+}
+
+std::shared_ptr<DocumentCache::PdfHandle> DocumentCache::pdf(const QString& file, const QByteArray& password) {
+	std::shared_ptr<PdfHandle> handle = acquire(m_pdfs, file);
+	// The document is loaded by the first user, the concurrent users of the file wait for it here
+	QMutexLocker locker(&handle->mutex);
+	if(!handle->document) {
+		handle->document = Poppler::Document::load(file);
+		if(handle->document) {
+			handle->document->setRenderHint(Poppler::Document::Antialiasing);
+			handle->document->setRenderHint(Poppler::Document::TextAntialiasing);
+		}
+	}
+	if(handle->document && handle->document->isLocked() && !password.isEmpty()) {
+		handle->document->unlock(password, password);
+	}
+	return handle;
+}
+
+std::shared_ptr<DocumentCache::DjVuHandle> DocumentCache::djvu(const QString& file) {
+	std::shared_ptr<DjVuHandle> handle = acquire(m_djvus, file);
+	QMutexLocker locker(&handle->mutex);
+	if(!handle->opened) {
+		handle->opened = handle->document.openFile(file);
+	}
+	return handle;
+}
+
+std::shared_ptr<DocumentCache::ImageHandle> DocumentCache::image(const QString& file) {
+	std::shared_ptr<ImageHandle> handle = acquire(m_images, file);
+	QMutexLocker locker(&handle->mutex);
+	if(handle->pageCount < 0) {
+		handle->pageCount = QImageReader(file).imageCount();
+	}
+	return handle;
+}
@@ -0,0 +1,82 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * DocumentCache.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DOCUMENTCACHE_HH
+#define DOCUMENTCACHE_HH
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <memory>
+
+#include "DjVuDocument.hh"
+
+namespace Poppler {
+class Document;
+}
+
+// Shares the opened documents between the displayer, its background renderers, the recognizer and the
+// exporters, so that each file is parsed once while it is in use. A document remains open while a handle
+// to it exists, and the most recently acquired documents stay open for a while after, i.e. while the
+// displayer recreates its renderer. A file which was modified since it was opened is opened anew.
+class DocumentCache {
+public:
+	// The mutex serializes the calls into the document, except for the rendering of the pages obtained from it
+	struct PdfHandle {
+		~PdfHandle();
+		Poppler::Document* document = nullptr;
+		QMutex mutex;
+	};
+	// The document serializes the decoding of its pages itself, the mutex only guards the opening
+	struct DjVuHandle {
+		DjVuDocument document;
+		bool opened = false;
+		QMutex mutex;
+	};
+	// Images are decoded by a reader per render, the handle shares the information read from the headers
+	struct ImageHandle {
+		int pageCount = -1;
+		QMap<int, QSize> pageSizes; // Unscaled, by zero-based page
+		QMutex mutex;
+	};
+
+	static DocumentCache& instance();
+
+	// A locked PDF is unlocked with the password, the handle holds a null document if the file cannot be loaded
+	std::shared_ptr<PdfHandle> pdf(const QString& file, const QByteArray& password = QByteArray());
+	std::shared_ptr<DjVuHandle> djvu(const QString& file);
+	std::shared_ptr<ImageHandle> image(const QString& file);
+
+private:
+	QMutex m_mutex;
+	QHash<QString, std::weak_ptr<PdfHandle>> m_pdfs;
+	QHash<QString, std::weak_ptr<DjVuHandle>> m_djvus;
+	QHash<QString, std::weak_ptr<ImageHandle>> m_images;
+	QList<std::shared_ptr<void>> m_recent;
+
+	DocumentCache() = default;
+	template<class T>
+	std::shared_ptr<T> acquire(QHash<QString, std::weak_ptr<T>>& handles, const QString& file);
+};
+
+#endif // DOCUMENTCACHE_HH
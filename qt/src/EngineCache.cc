@@ -0,0 +1,229 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * EngineCache.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QThread>
+#include <algorithm>
+#include <csignal>
+#include <functional>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+
+#include "EngineCache.hh"
+#include "MainWindow.hh"
+
+class WarmThread : public QThread {
+public:
+	WarmThread(const std::function<void()>& f) : m_f(f) {}
+private:
+	std::function<void()> m_f;
+	void run() override {
+		m_f();
+	}
+};
+
+EngineCache::Engine& EngineCache::Engine::operator=(Engine&& other) {
+	release();
+	m_cache = other.m_cache;
+	m_key = other.m_key;
+	m_generation = other.m_generation;
+	m_tess = other.m_tess;
+	other.m_cache = nullptr;
+	other.m_tess = nullptr;
+	return *this;
+}
+
+void EngineCache::Engine::release() {
+	if(m_tess) {
+		m_cache->giveBack(m_key, m_generation, m_tess);
+		m_tess = nullptr;
+		m_cache = nullptr;
+	}
+}
+
+EngineCache::~EngineCache() {
+	for(QThread* thread : m_warmThreads) {
+		thread->wait();
+		delete thread;
+	}
+	for(const Entry& entry : m_entries) {
+		qDeleteAll(entry.idle);
+	}
+}
+
+QMutex& EngineCache::initMutex() {
+	static QMutex mutex;
+	return mutex;
+}
+
+tesseract::TessBaseAPI* EngineCache::createEngine(const Key& key, bool* ok) {
+	// Engines may be initialized concurrently, but setlocale is process-wide
+	QMutexLocker locker(&initMutex());
+	// unfortunately tesseract creates deliberate aborts when an error occurs
+	if(MAIN) {
+		std::signal(SIGABRT, MainWindow::tesseractCrash);
+	}
+	QByteArray current = setlocale(LC_ALL, NULL);
+	setlocale(LC_ALL, "C");
+	tesseract::TessBaseAPI* tess = new tesseract::TessBaseAPI();
+	QByteArray language = key.language.toLocal8Bit();
+	QByteArray datapath = key.datapath.toLocal8Bit();
+	int ret = tess->Init(key.datapath.isEmpty() ? nullptr : datapath.constData(), key.language.isEmpty() ? nullptr : language.constData(), static_cast<tesseract::OcrEngineMode>(key.oem));
+	setlocale(LC_NUMERIC, current.constData());
+
+	if(ok) {
+		*ok = ret != -1;
+	}
+	return tess;
+}
+
+EngineCache::Entry& EngineCache::getEntry(const Key& key, bool touch) {
+	for(int i = 0, n = m_entries.size(); i < n; ++i) {
+		if(m_entries[i].key == key) {
+			if(!touch) {
+				return m_entries[i];
+			}
+			m_entries.move(i, 0);
+			return m_entries.first();
+		}
+	}
+	m_entries.prepend(Entry{key, {}, 0, 0});
+	return m_entries.first();
+}
+
+EngineCache::Engine EngineCache::acquire(const QString& language, int oem, const QString& datapath, bool* ok) {
+	Key key = {language, oem, datapath};
+	Engine engine;
+	engine.m_cache = this;
+	engine.m_key = key;
+
+	QMutexLocker locker(&m_mutex);
+	// Rather wait for an engine which is being warmed than initializing yet another one
+	while(getEntry(key).idle.isEmpty() && getEntry(key).warming > 0) {
+		m_cond.wait(&m_mutex);
+	}
+	Entry& entry = getEntry(key);
+	++entry.busy;
+	engine.m_generation = m_generation;
+	if(!entry.idle.isEmpty()) {
+		engine.m_tess = entry.idle.takeLast();
+		if(ok) {
+			*ok = true;
+		}
+		trim();
+		return engine;
+	}
+	trim();
+	locker.unlock();
+
+	bool initOk = false;
+	engine.m_tess = createEngine(key, &initOk);
+	if(!initOk) {
+		// Hand out the engine nonetheless, callers may still query e.g. the available languages
+		engine.m_generation = -1;
+	}
+	if(ok) {
+		*ok = initOk;
+	}
+	return engine;
+}
+
+void EngineCache::giveBack(const Key& key, int generation, tesseract::TessBaseAPI* tess) {
+	QMutexLocker locker(&m_mutex);
+	Entry& entry = getEntry(key, false);
+	--entry.busy;
+	if(generation != m_generation || entry.idle.size() >= m_maxIdlePerKey) {
+		locker.unlock();
+		delete tess;
+		return;
+	}
+	tess->Clear();
+	tess->ClearAdaptiveClassifier();
+	entry.idle.append(tess);
+	trim();
+	m_cond.wakeAll();
+}
+
+void EngineCache::warm(const QString& language, int oem, const QString& datapath) {
+	Key key = {language, oem, datapath};
+	QMutexLocker locker(&m_mutex);
+	for(int i = m_warmThreads.size(); i-- > 0;) {
+		if(m_warmThreads[i]->isFinished()) {
+			delete m_warmThreads.takeAt(i);
+		}
+	}
+	Entry& entry = getEntry(key);
+	if(!entry.idle.isEmpty() || entry.warming > 0) {
+		return;
+	}
+	++entry.warming;
+	int generation = m_generation;
+	QThread* thread = new WarmThread([this, key, generation] {
+		bool ok = false;
+		tesseract::TessBaseAPI* tess = createEngine(key, &ok);
+		QMutexLocker locker(&m_mutex);
+		Entry& entry = getEntry(key, false);
+		--entry.warming;
+		if(ok && generation == m_generation) {
+			entry.idle.append(tess);
+			tess = nullptr;
+		}
+		trim();
+		m_cond.wakeAll();
+		locker.unlock();
+		delete tess;
+	});
+	m_warmThreads.append(thread);
+	thread->start();
+}
+
+void EngineCache::clear() {
+	QMutexLocker locker(&m_mutex);
+	++m_generation;
+	for(Entry& entry : m_entries) {
+		qDeleteAll(entry.idle);
+		entry.idle.clear();
+	}
+	trim();
+}
+
+void EngineCache::setMaxIdlePerKey(int maxIdle) {
+	QMutexLocker locker(&m_mutex);
+	m_maxIdlePerKey = std::max(1, maxIdle);
+}
+
+void EngineCache::setMaxKeys(int maxKeys) {
+	QMutexLocker locker(&m_mutex);
+	m_maxKeys = std::max(1, maxKeys);
+	trim();
+}
+
+void EngineCache::trim() {
+	// Called with m_mutex locked. Only keep idle engines of the most recently used keys.
+	for(int i = m_entries.size(); i-- > 0;) {
+		Entry& entry = m_entries[i];
+		if(i >= m_maxKeys) {
+			qDeleteAll(entry.idle);
+			entry.idle.clear();
+		}
+		if(entry.idle.isEmpty() && entry.busy == 0 && entry.warming == 0) {
+			m_entries.removeAt(i);
+		}
+	}
+}
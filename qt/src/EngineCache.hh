@@ -0,0 +1,114 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * EngineCache.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENGINECACHE_HH
+#define ENGINECACHE_HH
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <utility>
+
+namespace tesseract {
+class TessBaseAPI;
+}
+class QThread;
+
+// Keeps initialized tesseract engines around for reuse, since loading the
+// traineddata can take seconds. Engines are keyed by the parameters which
+// can only be specified at initialization time, the caller is responsible
+// for (re-)applying all other variables after acquiring an engine.
+class EngineCache {
+public:
+	struct Key {
+		QString language;
+		int oem; // tesseract::OcrEngineMode
+		QString datapath; // Directory with the traineddata, empty for the configured tessdata location
+		bool operator==(const Key& other) const {
+			return language == other.language && oem == other.oem && datapath == other.datapath;
+		}
+	};
+
+	class Engine {
+	public:
+		Engine() = default;
+		Engine(Engine&& other) {
+			*this = std::move(other);
+		}
+		Engine& operator=(Engine&& other);
+		~Engine() {
+			release();
+		}
+		tesseract::TessBaseAPI* operator->() const {
+			return m_tess;
+		}
+		tesseract::TessBaseAPI& operator*() const {
+			return *m_tess;
+		}
+		explicit operator bool() const {
+			return m_tess != nullptr;
+		}
+		void release();
+
+	private:
+		friend class EngineCache;
+		EngineCache* m_cache = nullptr;
+		Key m_key;
+		int m_generation = 0;
+		tesseract::TessBaseAPI* m_tess = nullptr;
+	};
+
+	EngineCache() = default;
+	~EngineCache();
+	Engine acquire(const QString& language, int oem, const QString& datapath, bool* ok = nullptr);
+	// Initializes an engine in the background, unless one is already available
+	void warm(const QString& language, int oem, const QString& datapath);
+	// Discards all idle engines, i.e. after the installed languages changed
+	void clear();
+	void setMaxIdlePerKey(int maxIdle);
+	// Number of most recently used keys whose idle engines are kept
+	void setMaxKeys(int maxKeys);
+	// Serializes the construction and initialization of tesseract engines, for which the process-wide
+	// locale is temporarily switched to "C". To be held by all code doing so, also outside of the cache.
+	static QMutex& initMutex();
+
+private:
+	struct Entry {
+		Key key;
+		QList<tesseract::TessBaseAPI*> idle;
+		int busy;
+		int warming;
+	};
+
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	QList<Entry> m_entries; // Most recently used first
+	QList<QThread*> m_warmThreads;
+	int m_generation = 0;
+	int m_maxIdlePerKey = 1;
+	int m_maxKeys = 2;
+
+	static tesseract::TessBaseAPI* createEngine(const Key& key, bool* ok);
+	Entry& getEntry(const Key& key, bool touch = true);
+	void giveBack(const Key& key, int generation, tesseract::TessBaseAPI* tess);
+	void trim();
+};
+
+#endif // ENGINECACHE_HH
@@ -0,0 +1,121 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * JobJournal.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QDesktopServices>
+#else
+#include <QStandardPaths>
+#endif
+
+#include "JobJournal.hh"
+
+static const QByteArray JOURNAL_HEADER("gImageReader journal 1\n");
+// Journals of jobs which were not resumed within this many days are deleted
+static const int JOURNAL_MAX_AGE_DAYS = 30;
+
+JobJournal::JobJournal(const QByteArray& key) {
+	QString dir = journalDir();
+	removeStale(dir);
+	m_filename = QDir(dir).absoluteFilePath(key);
+	m_file.setFileName(m_filename);
+
+	// Each page is a line "<pageIdx> <angle> <result>...", with the results base64 encoded.
+	// A trailing line without newline stems from an interrupted write and is dropped.
+	QFile file(m_filename);
+	if(!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	QByteArray data = file.readAll();
+	if(!data.startsWith(JOURNAL_HEADER)) {
+		return;
+	}
+	int pos = m_validSize = JOURNAL_HEADER.size();
+	for(int end = data.indexOf('\n', pos); end >= 0; end = data.indexOf('\n', pos)) {
+		QList<QByteArray> fields = data.mid(pos, end - pos).split(' ');
+		pos = m_validSize = end + 1;
+		if(fields.size() < 3) {
+			continue;
+		}
+		bool idxOk = false, angleOk = false;
+		int pageIdx = fields[0].toInt(&idxOk);
+		Page page;
+		page.angle = fields[1].toDouble(&angleOk);
+		if(!idxOk || !angleOk) {
+			continue;
+		}
+		for(int i = 2, n = fields.size(); i < n; ++i) {
+			page.results.append(QString::fromUtf8(QByteArray::fromBase64(fields[i])));
+		}
+		m_pages.insert(pageIdx, page);
+	}
+}
+
+QByteArray JobJournal::computeKey(const QStringList& jobDescription) {
+	return QCryptographicHash::hash(jobDescription.join("\n").toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+void JobJournal::append(int pageIdx, const Page& page) {
+	if(!m_file.isOpen()) {
+		if(!QDir().mkpath(QFileInfo(m_filename).absolutePath()) || !m_file.open(QIODevice::ReadWrite)) {
+			return;
+		}
+		// Continue after the last complete line of the previous run
+		m_file.resize(m_validSize);
+		m_file.seek(m_validSize);
+		if(m_validSize == 0) {
+			m_file.write(JOURNAL_HEADER);
+		}
+	}
+	QByteArray line = QByteArray::number(pageIdx) + " " + QByteArray::number(page.angle, 'g', 17);
+	for(const QString& result : page.results) {
+		line += " " + result.toUtf8().toBase64();
+	}
+	m_file.write(line + "\n");
+	// Hand the line to the operating system right away, so that it survives a crash of the application
+	m_file.flush();
+}
+
+void JobJournal::discard() {
+	m_file.close();
+	QFile::remove(m_filename);
+	m_pages.clear();
+	m_validSize = 0;
+}
+
+QString JobJournal::journalDir() {
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+	QString dataDir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#else
+	QString dataDir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#endif
+	return QDir(dataDir).absoluteFilePath("journals");
+}
+
+void JobJournal::removeStale(const QString& dir) {
+	QDateTime limit = QDateTime::currentDateTime().addDays(-JOURNAL_MAX_AGE_DAYS);
+	for(const QFileInfo& info : QDir(dir).entryInfoList(QDir::Files)) {
+		if(info.lastModified() < limit) {
+			QFile::remove(info.absoluteFilePath());
+		}
+	}
+}
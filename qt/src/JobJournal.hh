@@ -0,0 +1,67 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * JobJournal.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOBJOURNAL_HH
+#define JOBJOURNAL_HH
+
+#include <QByteArray>
+#include <QFile>
+#include <QMap>
+#include <QStringList>
+
+// Append-only journal of the pages completed by a recognition job. The journal
+// is identified by a key describing the job, so that rerunning an interrupted
+// job finds the pages which were already recognized.
+class JobJournal {
+public:
+	struct Page {
+		double angle;
+		QStringList results; // One per recognized area
+	};
+
+	// Loads the journal of a previous run of the job, if any
+	JobJournal(const QByteArray& key);
+
+	static QByteArray computeKey(const QStringList& jobDescription);
+
+	int completedPages() const {
+		return m_pages.size();
+	}
+	// The completed pages are those of the previous run, appended pages are not included
+	bool contains(int pageIdx) const {
+		return m_pages.contains(pageIdx);
+	}
+	const Page& page(int pageIdx) const {
+		return m_pages.find(pageIdx).value();
+	}
+	void append(int pageIdx, const Page& page);
+	// Deletes the journal, i.e. when the job has completed or is not to be resumed
+	void discard();
+
+private:
+	QString m_filename;
+	QFile m_file;
+	QMap<int, Page> m_pages;
+	qint64 m_validSize = 0;
+
+	static QString journalDir();
+	static void removeStale(const QString& dir);
+};
+
+#endif // JOBJOURNAL_HH
@@ -46,7 +46,10 @@
 #include "DisplayerToolHOCR.hh"
 #include "OutputEditorText.hh"
 #include "OutputEditorHOCR.hh"
+#include "PerformanceLog.hh"
 #include "Recognizer.hh"
+#include "RenderCache.hh"
+#include "ResultCache.hh"
 #include "SourceManager.hh"
 #include "TessdataManager.hh"
 #include "Utils.hh"
@@ -130,6 +133,10 @@ MainWindow::MainWindow(const QStringList& files)
 	ui.setupUi(this);
 
 	m_config = new Config(this);
+	m_renderCache = new RenderCache();
+	m_renderCache->setMaxSize(m_config->renderCacheSize());
+	m_resultCache = new ResultCache();
+	m_performanceLog = new PerformanceLog(this);
 	m_acquirer = new Acquirer(ui);
 	m_displayer = new Displayer(ui);
 	m_recognizer = new Recognizer(ui);
@@ -156,6 +163,7 @@ MainWindow::MainWindow(const QStringList& files)
 	connect(ui.actionRedetectLanguages, SIGNAL(triggered()), m_recognizer, SLOT(updateLanguagesMenu()));
 	connect(ui.actionManageLanguages, SIGNAL(triggered()), this, SLOT(manageLanguages()));
 	connect(ui.actionPreferences, SIGNAL(triggered()), this, SLOT(showConfig()));
+	connect(ui.actionPerformance, SIGNAL(triggered()), m_performanceLog, SLOT(showDialog()));
 	connect(ui.actionHelp, SIGNAL(triggered()), this, SLOT(showHelp()));
 	connect(ui.actionAbout, SIGNAL(triggered()), this, SLOT(showAbout()));
 	connect(ui.actionImageControls, SIGNAL(toggled(bool)), ui.widgetImageControls, SLOT(setVisible(bool)));
@@ -222,6 +230,9 @@ MainWindow::~MainWindow() {
 	delete m_displayerTool;
 	delete m_displayer;
 	delete m_recognizer;
+	delete m_resultCache;
+	delete m_renderCache;
+	delete m_performanceLog;
 	delete m_config;
 	s_instance = nullptr;
 }
@@ -38,7 +38,10 @@ class Acquirer;
 class Displayer;
 class DisplayerTool;
 class OutputEditor;
+class PerformanceLog;
 class Recognizer;
+class RenderCache;
+class ResultCache;
 class SourceManager;
 class Source;
 class QProgressBar;
@@ -103,9 +106,18 @@ public:
 	OutputEditor* getOutputEditor() {
 		return m_outputEditor;
 	}
+	PerformanceLog* getPerformanceLog() {
+		return m_performanceLog;
+	}
 	Recognizer* getRecognizer() {
 		return m_recognizer;
 	}
+	RenderCache* getRenderCache() {
+		return m_renderCache;
+	}
+	ResultCache* getResultCache() {
+		return m_resultCache;
+	}
 	SourceManager* getSourceManager() {
 		return m_sourceManager;
 	}
@@ -135,7 +147,10 @@ private:
 	Displayer* m_displayer = nullptr;
 	DisplayerTool* m_displayerTool = nullptr;
 	OutputEditor* m_outputEditor = nullptr;
+	PerformanceLog* m_performanceLog = nullptr;
 	Recognizer* m_recognizer = nullptr;
+	RenderCache* m_renderCache = nullptr;
+	ResultCache* m_resultCache = nullptr;
 	SourceManager* m_sourceManager = nullptr;
 
 	QActionGroup m_idleActions;
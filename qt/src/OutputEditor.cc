@@ -18,6 +18,15 @@
  */
 
 
+#include <QDomDocument>
+#include <QPoint>
+#include <QSize>
+#include <QStringList>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+
+#include "HOCRDocument.hh"
 #include "OutputEditor.hh"
 
 Q_DECLARE_METATYPE(OutputEditor::ReadSessionData)
@@ -26,3 +35,49 @@ OutputEditor::OutputEditor(QObject* parent) : QObject(parent) {
 	static int reg = qRegisterMetaType<ReadSessionData>("ReadSessionData");
 	Q_UNUSED(reg);
 }
+
+void OutputEditor::prepareEngine(tesseract::TessBaseAPI& tess, ResultFormat format) {
+	if(format == ResultFormat::HOCR) {
+		tess.SetPageSegMode(tesseract::PSM_AUTO_ONLY);
+		tess.SetVariable("hocr_font_info", "true");
+	} else {
+		tess.SetVariable("hocr_font_info", "false");
+	}
+}
+
+QString OutputEditor::extractResult(tesseract::TessBaseAPI& tess, ResultFormat format, int page) {
+	char* text = format == ResultFormat::HOCR ? tess.GetHOCRText(page) : tess.GetUTF8Text();
+	QString result = QString::fromUtf8(text);
+	delete[] text;
+	return result;
+}
+
+QString OutputEditor::skippedResult(ResultFormat format, int page, const QSize& size, const QString& reason, const QString& description) {
+	if(format == ResultFormat::HOCR) {
+		return QString("<div class='ocr_page' id='page_%1' title='bbox 0 0 %2 %3; x_skipped %4'></div>\n").arg(page).arg(size.width()).arg(size.height()).arg(reason);
+	}
+	return _("[Page skipped: %1]").arg(description);
+}
+
+QString OutputEditor::mergeResults(ResultFormat format, int page, const QSize& size, const QStringList& results, const QList<QPoint>& offsets) {
+	if(format != ResultFormat::HOCR) {
+		return results.join("\n");
+	}
+	QDomDocument doc;
+	QDomElement pageDiv = doc.createElement("div");
+	pageDiv.setAttribute("class", "ocr_page");
+	pageDiv.setAttribute("id", QString("page_%1").arg(page));
+	pageDiv.setAttribute("title", QString("bbox 0 0 %1 %2").arg(size.width()).arg(size.height()));
+	doc.appendChild(pageDiv);
+	for(int i = 0, n = results.size(); i < n; ++i) {
+		QDomDocument blockDoc;
+		blockDoc.setContent(results[i]);
+		QDomElement blockPage = blockDoc.firstChildElement("div");
+		// The item ids are regenerated when the page is added to the document
+		for(QDomElement child = blockPage.firstChildElement(); !child.isNull(); child = blockPage.firstChildElement()) {
+			HOCRItem::mapBBoxes(child, offsets[i]);
+			pageDiv.appendChild(doc.importNode(blockPage.removeChild(child).toElement(), true));
+		}
+	}
+	return doc.toString();
+}
@@ -21,6 +21,7 @@
 #define OUTPUTEDITOR_HH
 
 #include <QObject>
+#include <memory>
 #include "Config.hh"
 
 namespace tesseract {
@@ -30,6 +31,14 @@ class TessBaseAPI;
 class OutputEditor : public QObject {
 	Q_OBJECT
 public:
+	enum class ResultFormat { Text, HOCR };
+	// Result in the representation of the editor, built directly from the engine instead of parsing the extracted output
+	class Result {
+	public:
+		virtual ~Result() = default;
+		// The result as extracted by extractResult, i.e. for the result cache
+		virtual QString toString() const = 0;
+	};
 	struct ReadSessionData {
 		virtual ~ReadSessionData() = default;
 		bool prependFile;
@@ -38,14 +47,46 @@ public:
 		QString file;
 		double angle;
 		int resolution;
+		int timingId = -1; // Id of the page in the performance log
 	};
 
 	OutputEditor(QObject* parent = 0);
 
 	virtual QWidget* getUI() = 0;
-	virtual ReadSessionData* initRead(tesseract::TessBaseAPI& tess) = 0;
-	virtual void read(tesseract::TessBaseAPI& tess, ReadSessionData* data) = 0;
+	virtual ReadSessionData* initRead() = 0;
+	virtual ResultFormat resultFormat() const = 0;
+	// Applies editor specific settings to a recognition engine, before it is used
+	void prepareEngine(tesseract::TessBaseAPI& tess) const {
+		prepareEngine(tess, resultFormat());
+	}
+	// Retrieves the recognized output from the engine. May be called concurrently from multiple worker threads.
+	QString extractResult(tesseract::TessBaseAPI& tess, int page) const {
+		return extractResult(tess, resultFormat(), page);
+	}
+	// As above, but usable without output editor instance, i.e. in recognition worker processes
+	static void prepareEngine(tesseract::TessBaseAPI& tess, ResultFormat format);
+	static QString extractResult(tesseract::TessBaseAPI& tess, ResultFormat format, int page);
+	// Result for a page which was skipped instead of recognized: an empty hOCR page of the given size
+	// whose x_skipped property holds the reason, respectively a note with the description in the text
+	static QString skippedResult(ResultFormat format, int page, const QSize& size, const QString& reason, const QString& description);
+	// Combines the results of blocks recognized separately into the result for the page of the given size.
+	// The offsets are the positions of the blocks on the page, the hOCR coordinates are shifted accordingly.
+	static QString mergeResults(ResultFormat format, int page, const QSize& size, const QStringList& results, const QList<QPoint>& offsets);
+	// Builds the result of a page of the given size from the engine, or returns a null pointer if the editor only reads
+	// the extracted output. May be called concurrently from multiple worker threads.
+	virtual std::shared_ptr<Result> buildResult(tesseract::TessBaseAPI& /*tess*/, int /*page*/, const QSize& /*size*/) const {
+		return nullptr;
+	}
+	// Adds the previously extracted output. Calls are serialized, in output order.
+	virtual void readResult(const QString& result, ReadSessionData* data) = 0;
+	// As above, for a result returned by buildResult
+	virtual void readBuiltResult(const std::shared_ptr<Result>& result, ReadSessionData* data) {
+		readResult(result->toString(), data);
+	}
 	virtual void readError(const QString& errorMsg, ReadSessionData* data) = 0;
+	void read(tesseract::TessBaseAPI& tess, ReadSessionData* data) {
+		readResult(extractResult(tess, data->page), data);
+	}
 	virtual void finalizeRead(ReadSessionData* data) {
 		delete data;
 	}
@@ -29,6 +29,7 @@
 #include "ConfigSettings.hh"
 #include "FileDialogs.hh"
 #include "OutputEditorText.hh"
+#include "PerformanceLog.hh"
 #include "Recognizer.hh"
 #include "SourceManager.hh"
 #include "Utils.hh"
@@ -184,9 +185,8 @@ void OutputEditorText::applySubstitutions(const QMap<QString, QString>& substitu
 	MAIN->popState();
 }
 
-void OutputEditorText::read(tesseract::TessBaseAPI& tess, ReadSessionData* data) {
-	char* textbuf = tess.GetUTF8Text();
-	QString text = QString::fromUtf8(textbuf);
+void OutputEditorText::readResult(const QString& result, ReadSessionData* data) {
+	QString text = result;
 	if(!text.endsWith('\n')) {
 		text.append('\n');
 	}
@@ -201,18 +201,18 @@ void OutputEditorText::read(tesseract::TessBaseAPI& tess, ReadSessionData* data)
 		text.prepend(QString("[%1]\n").arg(prepend.join("; ")));
 	}
 	bool& insertText = static_cast<TextReadSessionData*>(data)->insertText;
-	QMetaObject::invokeMethod(this, "addText", Qt::QueuedConnection, Q_ARG(QString, text), Q_ARG(bool, insertText));
-	delete[] textbuf;
+	QMetaObject::invokeMethod(this, "addText", Qt::QueuedConnection, Q_ARG(QString, text), Q_ARG(bool, insertText), Q_ARG(int, data->timingId));
 	insertText = true;
 }
 
 void OutputEditorText::readError(const QString& errorMsg, ReadSessionData* data) {
 	bool& insertText = static_cast<TextReadSessionData*>(data)->insertText;
-	QMetaObject::invokeMethod(this, "addText", Qt::QueuedConnection, Q_ARG(QString, errorMsg), Q_ARG(bool, insertText));
+	QMetaObject::invokeMethod(this, "addText", Qt::QueuedConnection, Q_ARG(QString, errorMsg), Q_ARG(bool, insertText), Q_ARG(int, -1));
 	insertText = true;
 }
 
-void OutputEditorText::addText(const QString& text, bool insert) {
+void OutputEditorText::addText(const QString& text, bool insert, int timingId) {
+	PerformanceLog::Timer timer;
 	if(insert) {
 		ui.plainTextEditOutput->textCursor().insertText(text);
 	} else {
@@ -228,6 +228,7 @@ void OutputEditorText::addText(const QString& text, bool insert) {
 		cursor.insertText(text);
 		ui.plainTextEditOutput->setTextCursor(cursor);
 	}
+	MAIN->getPerformanceLog()->addTime(timingId, PerformanceLog::StageInsert, timer);
 	MAIN->setOutputPaneVisible(true);
 }
 
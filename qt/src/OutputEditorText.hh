@@ -36,10 +36,13 @@ public:
 	QWidget* getUI() override {
 		return m_widget;
 	}
-	ReadSessionData* initRead(tesseract::TessBaseAPI& /*tess*/) override {
+	ReadSessionData* initRead() override {
 		return new TextReadSessionData;
 	}
-	void read(tesseract::TessBaseAPI& tess, ReadSessionData* data) override;
+	ResultFormat resultFormat() const override {
+		return ResultFormat::Text;
+	}
+	void readResult(const QString& result, ReadSessionData* data) override;
 	void readError(const QString& errorMsg, ReadSessionData* data) override;
 	bool getModified() const override;
 
@@ -63,7 +66,7 @@ private:
 	QtSpell::TextEditChecker m_spell;
 
 private slots:
-	void addText(const QString& text, bool insert);
+	void addText(const QString& text, bool insert, int timingId);
 	void filterBuffer();
 	void findReplace(const QString& searchstr, const QString& replacestr, bool matchCase, bool backwards, bool replace);
 	void replaceAll(const QString& searchstr, const QString& replacestr, bool matchCase);
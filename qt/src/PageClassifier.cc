@@ -0,0 +1,186 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * PageClassifier.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QImage>
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+#include "PageClassifier.hh"
+
+// Borders of the page which are ignored, since they often contain scanner shadows and punch holes
+static const double MARGIN = 0.05;
+// Pixels which are darker than this fraction of the paper brightness are ink
+static const double INK_CONTRAST = 0.6;
+// Pages with less ink coverage are blank, this still exceeds dust and the odd speck
+static const double BLANK_MAX_COVERAGE = 0.0005;
+// Pages whose difference hashes differ in more bits are certainly no duplicates
+static const int HASH_MAX_DISTANCE = 12;
+// Width of the thumbnails which are compared to confirm a duplicate, a cell is roughly half a text line high
+static const int THUMBNAIL_WIDTH = 128;
+// Refed sheets are offset by up to this many thumbnail cells
+static const int THUMBNAIL_MAX_SHIFT = 3;
+// Mean absolute difference of the normalized thumbnails below which pages are duplicates
+static const double THUMBNAIL_MAX_DIFFERENCE = 0.3;
+
+PageClassifier::Verdict PageClassifier::classify(int pageIdx, const QImage& image, int* original) {
+	if(m_skipBlank && inkCoverage(image) < BLANK_MAX_COVERAGE) {
+		pass(pageIdx);
+		return Verdict::Blank;
+	}
+	if(!m_skipDuplicates) {
+		return Verdict::Recognize;
+	}
+	Signature signature = computeSignature(image);
+	QMutexLocker locker(&m_mutex);
+	while(m_nextIdx < pageIdx) {
+		m_cond.wait(&m_mutex);
+	}
+	Verdict verdict = Verdict::Recognize;
+	// Refed sheets usually follow closely, hence compare with the nearest preceding pages first
+	auto it = m_signatures.end();
+	while(it != m_signatures.begin()) {
+		--it;
+		if(isDuplicate(it.value(), signature)) {
+			if(original) {
+				*original = it.key();
+			}
+			verdict = Verdict::Duplicate;
+			break;
+		}
+	}
+	// Only kept pages are originals, a duplicate of a duplicate refers to the page which was kept
+	if(verdict == Verdict::Recognize) {
+		m_signatures.insert(pageIdx, signature);
+	}
+	advance(pageIdx);
+	return verdict;
+}
+
+void PageClassifier::pass(int pageIdx) {
+	if(!m_skipDuplicates) {
+		return;
+	}
+	QMutexLocker locker(&m_mutex);
+	if(pageIdx == m_nextIdx) {
+		advance(pageIdx);
+	} else if(pageIdx > m_nextIdx) {
+		m_passed.insert(pageIdx);
+	}
+}
+
+void PageClassifier::advance(int pageIdx) {
+	m_nextIdx = pageIdx + 1;
+	while(m_passed.remove(m_nextIdx)) {
+		++m_nextIdx;
+	}
+	m_cond.wakeAll();
+}
+
+double PageClassifier::inkCoverage(const QImage& image) {
+	QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+	int x1 = qRound(MARGIN * rgb.width()), x2 = rgb.width() - x1;
+	int y1 = qRound(MARGIN * rgb.height()), y2 = rgb.height() - y1;
+	int total = (x2 - x1) * (y2 - y1);
+	if(total <= 0) {
+		return 0.;
+	}
+	std::vector<int> histogram(256, 0);
+	for(int y = y1; y < y2; ++y) {
+		const QRgb* line = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+		for(int x = x1; x < x2; ++x) {
+			++histogram[qGray(line[x])];
+		}
+	}
+	// The paper brightness is the level which 90% of the pixels do not exceed, as ink rarely covers more than a tenth of a page
+	int paper = 0;
+	int count = histogram[0];
+	while(paper < 255 && count < 0.9 * total) {
+		count += histogram[++paper];
+	}
+	int ink = 0;
+	for(int level = 0; level < INK_CONTRAST * paper; ++level) {
+		ink += histogram[level];
+	}
+	return double(ink) / total;
+}
+
+PageClassifier::Signature PageClassifier::computeSignature(const QImage& image) {
+	Signature signature;
+
+	// Difference hash: whether each cell of a 9x8 downscaled image is brighter than its right neighbour
+	QImage small = image.scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_RGB32);
+	signature.hash = 0;
+	for(int y = 0; y < 8; ++y) {
+		const QRgb* line = reinterpret_cast<const QRgb*>(small.constScanLine(y));
+		for(int x = 0; x < 8; ++x) {
+			signature.hash = (signature.hash << 1) | (qGray(line[x]) > qGray(line[x + 1]) ? 1 : 0);
+		}
+	}
+
+	// Thumbnail normalized to zero mean and unit variance, to be independent of exposure differences
+	signature.width = THUMBNAIL_WIDTH;
+	signature.height = std::max(1, qRound(double(THUMBNAIL_WIDTH) * image.height() / std::max(1, image.width())));
+	QImage thumbnail = image.scaled(signature.width, signature.height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_RGB32);
+	signature.thumbnail.resize(signature.width * signature.height);
+	double sum = 0., sumSquares = 0.;
+	for(int y = 0; y < signature.height; ++y) {
+		const QRgb* line = reinterpret_cast<const QRgb*>(thumbnail.constScanLine(y));
+		for(int x = 0; x < signature.width; ++x) {
+			float value = qGray(line[x]);
+			signature.thumbnail[y * signature.width + x] = value;
+			sum += value;
+			sumSquares += value * value;
+		}
+	}
+	int n = signature.thumbnail.size();
+	double mean = sum / n;
+	double stddev = std::sqrt(std::max(0., sumSquares / n - mean * mean));
+	for(float& value : signature.thumbnail) {
+		value = stddev > 0. ? (value - mean) / stddev : 0.f;
+	}
+	return signature;
+}
+
+bool PageClassifier::isDuplicate(const Signature& sig1, const Signature& sig2) {
+	if(std::bitset<64>(sig1.hash ^ sig2.hash).count() > HASH_MAX_DISTANCE || std::abs(sig1.height - sig2.height) > THUMBNAIL_MAX_SHIFT) {
+		return false;
+	}
+	// The thumbnails of a refed sheet match when shifted by the offset of the sheet
+	int width = sig1.width;
+	int height = std::min(sig1.height, sig2.height);
+	for(int dy = -THUMBNAIL_MAX_SHIFT; dy <= THUMBNAIL_MAX_SHIFT; ++dy) {
+		for(int dx = -THUMBNAIL_MAX_SHIFT; dx <= THUMBNAIL_MAX_SHIFT; ++dx) {
+			double difference = 0.;
+			int count = 0;
+			for(int y = std::max(0, -dy), yEnd = std::min(height, height - dy); y < yEnd; ++y) {
+				const float* row1 = &sig1.thumbnail[y * width];
+				const float* row2 = &sig2.thumbnail[(y + dy) * width];
+				for(int x = std::max(0, -dx), xEnd = std::min(width, width - dx); x < xEnd; ++x) {
+					difference += std::abs(row1[x] - row2[x + dx]);
+				}
+				count += std::min(width, width - dx) - std::max(0, -dx);
+			}
+			if(count > 0 && difference / count < THUMBNAIL_MAX_DIFFERENCE) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
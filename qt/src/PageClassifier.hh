@@ -0,0 +1,82 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * PageClassifier.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAGECLASSIFIER_HH
+#define PAGECLASSIFIER_HH
+
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QWaitCondition>
+#include <vector>
+
+class QImage;
+
+// Cheap checks which run on a low resolution proxy of a page before it is recognized,
+// to skip the pages which would not yield any new text: blank pages, i.e. the empty
+// backsides of a duplex scan, and pages which already occurred earlier in the same job,
+// i.e. sheets which were fed twice through the document feeder.
+class PageClassifier {
+public:
+	enum class Verdict { Recognize, Blank, Duplicate };
+
+	PageClassifier(bool skipBlank, bool skipDuplicates)
+		: m_skipBlank(skipBlank), m_skipDuplicates(skipDuplicates) {}
+
+	bool enabled() const {
+		return m_skipBlank || m_skipDuplicates;
+	}
+	bool skipDuplicates() const {
+		return m_skipDuplicates;
+	}
+	// May be called concurrently for the pages of a job. A page is only considered a duplicate of a kept
+	// page with a lower index, whose index is then returned in original. So that the verdicts do not depend
+	// on the order in which concurrent callers get to the pages, the comparison waits until every page with
+	// a lower index was either classified or passed.
+	Verdict classify(int pageIdx, const QImage& image, int* original = nullptr);
+	// Marks a page which is not classified, i.e. because it failed to render, so that the pages with a
+	// higher index do not wait for it. Has no effect on pages which were classified.
+	void pass(int pageIdx);
+
+	// Fraction of the page, apart from its margins, which is covered by ink
+	static double inkCoverage(const QImage& image);
+
+private:
+	struct Signature {
+		quint64 hash; // Difference hash, to quickly rule out most pages
+		int width, height;
+		std::vector<float> thumbnail; // Normalized to zero mean and unit variance
+	};
+
+	bool m_skipBlank;
+	bool m_skipDuplicates;
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	QMap<int, Signature> m_signatures; // Of the kept pages
+	int m_nextIdx = 0; // All pages with a lower index are classified or passed
+	QSet<int> m_passed; // Passed pages above m_nextIdx
+
+	void advance(int pageIdx);
+
+	static Signature computeSignature(const QImage& image);
+	static bool isDuplicate(const Signature& sig1, const Signature& sig2);
+};
+
+#endif // PAGECLASSIFIER_HH
@@ -0,0 +1,88 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * PagePrefetcher.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QMutexLocker>
+#include <algorithm>
+#include <memory>
+
+#include "CpuBudget.hh"
+#include "DisplayRenderer.hh"
+#include "MainWindow.hh"
+#include "PagePrefetcher.hh"
+#include "RenderCache.hh"
+
+// Upper bound of the prefetching threads, further threads would mostly compete with the displayed page
+static const int MAX_PREFETCH_THREADS = 2;
+
+PagePrefetcher::PagePrefetcher() {
+	int nThreads = std::max(1, std::min(MAX_PREFETCH_THREADS, CpuBudget::instance().cores() / 2));
+	for(int i = 0; i < nThreads; ++i) {
+		m_threads.append(new Thread(std::bind(&PagePrefetcher::run, this)));
+		m_threads.last()->start(QThread::LowPriority);
+	}
+}
+
+PagePrefetcher::~PagePrefetcher() {
+	m_mutex.lock();
+	m_queue.clear();
+	m_quit = true;
+	m_cond.wakeAll();
+	m_mutex.unlock();
+	for(Thread* thread : m_threads) {
+		thread->wait();
+	}
+	qDeleteAll(m_threads);
+}
+
+void PagePrefetcher::prefetch(const QList<Displayer::RenderSettings>& pages, double scale) {
+	QMutexLocker locker(&m_mutex);
+	m_queue.clear();
+	m_scale = scale;
+	for(const Displayer::RenderSettings& page : pages) {
+		m_queue.enqueue(page);
+	}
+	m_cond.wakeAll();
+}
+
+void PagePrefetcher::run() {
+	CpuBudget::setThreadShare(1);
+	// The renderer is kept while the pages are of the same file, i.e. to load a PDF only once
+	std::unique_ptr<DisplayRenderer> renderer;
+	QMutexLocker locker(&m_mutex);
+	while(true) {
+		while(m_queue.isEmpty() && !m_quit) {
+			m_cond.wait(&m_mutex);
+		}
+		if(m_quit) {
+			break;
+		}
+		Displayer::RenderSettings page = m_queue.dequeue();
+		double resolution = m_scale * page.resolution;
+		locker.unlock();
+		RenderCache* cache = MAIN->getRenderCache();
+		if(!cache->contains(RenderCache::adjustedKey(page.file, page.page, resolution, page.brightness, page.contrast, page.invert))) {
+			if(!renderer || renderer->getFilename() != page.file) {
+				renderer.reset(DisplayRenderer::create(page.file, page.password));
+			}
+			cache->render(*renderer, page.page, resolution, page.brightness, page.contrast, page.invert);
+		}
+		locker.relock();
+	}
+}
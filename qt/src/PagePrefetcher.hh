@@ -0,0 +1,68 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * PagePrefetcher.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PAGEPREFETCHER_HH
+#define PAGEPREFETCHER_HH
+
+#include <QList>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
+
+#include "Displayer.hh"
+
+// Renders the pages around the displayed page into the render cache on low priority
+// background threads, so that turning to them does not wait for the renderer.
+class PagePrefetcher {
+public:
+	PagePrefetcher();
+	~PagePrefetcher();
+
+	// Replaces the pages still to be rendered, the first pages are rendered first. The pages are
+	// rendered at the given scale of their resolution. Renders in progress are completed.
+	void prefetch(const QList<Displayer::RenderSettings>& pages, double scale = 1.);
+	void cancel() {
+		prefetch(QList<Displayer::RenderSettings>());
+	}
+
+private:
+	class Thread : public QThread {
+	public:
+		Thread(const std::function<void()>& f) : m_f(f) {}
+	private:
+		std::function<void()> m_f;
+		void run() override {
+			m_f();
+		}
+	};
+
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	QQueue<Displayer::RenderSettings> m_queue;
+	double m_scale = 1.;
+	QList<Thread*> m_threads;
+	bool m_quit = false;
+
+	void run();
+};
+
+#endif // PAGEPREFETCHER_HH
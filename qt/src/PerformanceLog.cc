@@ -0,0 +1,263 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * PerformanceLog.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTextStream>
+#include <algorithm>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "FileDialogs.hh"
+#include "MainWindow.hh"
+#include "PerformanceLog.hh"
+#include "Utils.hh"
+
+// Only the most recent pages are kept, the log must not grow without bound in a long session
+static const int MAX_RECORDS = 10000;
+
+void PerformanceLog::Timer::restart() {
+	m_wall.start();
+	m_cpuStart = threadCpuMsecs();
+}
+
+PerformanceLog::StageTime PerformanceLog::Timer::elapsed() const {
+	StageTime time;
+	time.wallMsecs = m_wall.nsecsElapsed() / 1000000.;
+	time.cpuMsecs = threadCpuMsecs() - m_cpuStart;
+	return time;
+}
+
+PerformanceLog::PerformanceLog(QWidget* parent)
+	: QDialog(parent) {
+	ui.setupUi(this);
+
+	QStringList headers = {_("File"), _("Page")};
+	for(int stage = 0; stage < NumStages; ++stage) {
+		headers.append(stageLabel(static_cast<Stage>(stage)));
+	}
+	headers.append(_("Total"));
+	headers.append(_("Skipped"));
+	ui.tableWidgetTimings->setColumnCount(headers.size());
+	ui.tableWidgetTimings->setHorizontalHeaderLabels(headers);
+
+	connect(ui.pushButtonClear, SIGNAL(clicked()), this, SLOT(clear()));
+	connect(ui.pushButtonExport, SIGNAL(clicked()), this, SLOT(exportLog()));
+}
+
+int PerformanceLog::addPage(const QString& file, int page) {
+	QMutexLocker locker(&m_mutex);
+	PageRecord record;
+	record.file = file;
+	record.page = page;
+	m_records.append(record);
+	if(m_records.size() > MAX_RECORDS) {
+		// The ids of the remaining records are unaffected, the timings of the dropped page are ignored
+		m_records.removeFirst();
+		++m_firstId;
+	}
+	return m_firstId + m_records.size() - 1;
+}
+
+void PerformanceLog::addTime(int id, Stage stage, const StageTime& time) {
+	QMutexLocker locker(&m_mutex);
+	int idx = id - m_firstId;
+	if(idx >= 0 && idx < m_records.size()) {
+		StageTime& total = m_records[idx].stages[stage];
+		total.wallMsecs += time.wallMsecs;
+		total.cpuMsecs += time.cpuMsecs;
+	}
+}
+
+void PerformanceLog::setSkipped(int id, const QString& reason) {
+	QMutexLocker locker(&m_mutex);
+	int idx = id - m_firstId;
+	if(idx >= 0 && idx < m_records.size()) {
+		m_records[idx].skipped = reason;
+	}
+}
+
+QString PerformanceLog::toJson() const {
+	QMutexLocker locker(&m_mutex);
+	QStringList pages;
+	for(const PageRecord& record : m_records) {
+		QStringList stages;
+		for(int stage = 0; stage < NumStages; ++stage) {
+			stages.append(QString("\"%1\": {\"wall_ms\": %2, \"thread_cpu_ms\": %3}").arg(stageName(static_cast<Stage>(stage)),
+			              QString::number(record.stages[stage].wallMsecs, 'f', 3), QString::number(record.stages[stage].cpuMsecs, 'f', 3)));
+		}
+		pages.append(QString("    {\"file\": %1, \"page\": %2, \"stages\": {%3}, \"skipped\": %4}").arg(Utils::jsonString(record.file), QString::number(record.page), stages.join(", "),
+		             record.skipped.isEmpty() ? QString("null") : Utils::jsonString(record.skipped)));
+	}
+	return QString("{\n  \"tesseract\": %1,\n  \"pages\": [\n%2\n  ]\n}\n").arg(Utils::jsonString(tesseract::TessBaseAPI::Version()), pages.join(",\n"));
+}
+
+QString PerformanceLog::toCsv() const {
+	QMutexLocker locker(&m_mutex);
+	QStringList columns = {"file", "page"};
+	for(int stage = 0; stage < NumStages; ++stage) {
+		columns.append(stageName(static_cast<Stage>(stage)) + "_wall_ms");
+		columns.append(stageName(static_cast<Stage>(stage)) + "_thread_cpu_ms");
+	}
+	columns.append("skipped");
+	QString csv = columns.join(",") + "\n";
+	for(const PageRecord& record : m_records) {
+		QString file = record.file;
+		columns = QStringList{QString("\"%1\"").arg(file.replace("\"", "\"\"")), QString::number(record.page)};
+		for(int stage = 0; stage < NumStages; ++stage) {
+			columns.append(QString::number(record.stages[stage].wallMsecs, 'f', 3));
+			columns.append(QString::number(record.stages[stage].cpuMsecs, 'f', 3));
+		}
+		columns.append(record.skipped);
+		csv += columns.join(",") + "\n";
+	}
+	return csv;
+}
+
+void PerformanceLog::showDialog() {
+	populateTable();
+	exec();
+}
+
+QString PerformanceLog::stageName(Stage stage) {
+	static const char* names[NumStages] = {"render", "adjust", "classify", "deskew", "layout", "route", "recognize", "retry", "parse", "insert"};
+	return names[stage];
+}
+
+QString PerformanceLog::stageLabel(Stage stage) {
+	switch(stage) {
+	case StageRender:
+		return _("Render");
+	case StageAdjust:
+		return _("Adjust");
+	case StageClassify:
+		return _("Classify");
+	case StageDeskew:
+		return _("Deskew");
+	case StageLayout:
+		return _("Layout");
+	case StageRoute:
+		return _("Routing");
+	case StageRecognize:
+		return _("Recognize");
+	case StageRetry:
+		return _("Retry");
+	case StageParse:
+		return _("Parse");
+	case StageInsert:
+		return _("Insert");
+	default:
+		return QString();
+	}
+}
+
+double PerformanceLog::threadCpuMsecs() {
+#ifdef Q_OS_WIN
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if(!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+		return 0.;
+	}
+	// FILETIME counts 100ns intervals
+	quint64 kernel = (quint64(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	quint64 user = (quint64(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+	return (kernel + user) / 10000.;
+#else
+	timespec ts;
+	if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+		return 0.;
+	}
+	return ts.tv_sec * 1000. + ts.tv_nsec / 1000000.;
+#endif
+}
+
+void PerformanceLog::populateTable() {
+	QMutexLocker locker(&m_mutex);
+	ui.tableWidgetTimings->setRowCount(0);
+	// Cells show "wall / thread CPU" in milliseconds, the last row sums up all pages
+	StageTime totals[NumStages];
+	for(int row = 0, n = m_records.size(); row <= n; ++row) {
+		const StageTime* stages = row < n ? m_records[row].stages : totals;
+		ui.tableWidgetTimings->insertRow(row);
+		if(row < n) {
+			ui.tableWidgetTimings->setItem(row, 0, new QTableWidgetItem(QFileInfo(m_records[row].file).fileName()));
+			ui.tableWidgetTimings->item(row, 0)->setToolTip(m_records[row].file);
+			ui.tableWidgetTimings->setItem(row, 1, new QTableWidgetItem(QString::number(m_records[row].page)));
+		} else {
+			ui.tableWidgetTimings->setItem(row, 0, new QTableWidgetItem(_("All pages")));
+			ui.tableWidgetTimings->setItem(row, 1, new QTableWidgetItem(QString::number(n)));
+		}
+		StageTime pageTotal;
+		for(int stage = 0; stage < NumStages; ++stage) {
+			if(row < n) {
+				totals[stage].wallMsecs += stages[stage].wallMsecs;
+				totals[stage].cpuMsecs += stages[stage].cpuMsecs;
+			}
+			pageTotal.wallMsecs += stages[stage].wallMsecs;
+			pageTotal.cpuMsecs += stages[stage].cpuMsecs;
+			ui.tableWidgetTimings->setItem(row, 2 + stage, new QTableWidgetItem(QString("%1 / %2").arg(stages[stage].wallMsecs, 0, 'f', 1).arg(stages[stage].cpuMsecs, 0, 'f', 1)));
+		}
+		ui.tableWidgetTimings->setItem(row, 2 + NumStages, new QTableWidgetItem(QString("%1 / %2").arg(pageTotal.wallMsecs, 0, 'f', 1).arg(pageTotal.cpuMsecs, 0, 'f', 1)));
+		if(row < n) {
+			ui.tableWidgetTimings->setItem(row, 3 + NumStages, new QTableWidgetItem(m_records[row].skipped));
+		} else {
+			int nSkipped = std::count_if(m_records.begin(), m_records.end(), [](const PageRecord & record) { return !record.skipped.isEmpty(); });
+			ui.tableWidgetTimings->setItem(row, 3 + NumStages, new QTableWidgetItem(QString::number(nSkipped)));
+		}
+	}
+	QFont font = ui.tableWidgetTimings->font();
+	font.setBold(true);
+	for(int col = 0, row = m_records.size(), n = ui.tableWidgetTimings->columnCount(); col < n; ++col) {
+		ui.tableWidgetTimings->item(row, col)->setFont(font);
+	}
+	ui.tableWidgetTimings->resizeColumnsToContents();
+	ui.pushButtonClear->setEnabled(!m_records.isEmpty());
+	ui.pushButtonExport->setEnabled(!m_records.isEmpty());
+}
+
+void PerformanceLog::clear() {
+	QMutexLocker locker(&m_mutex);
+	m_firstId += m_records.size();
+	m_records.clear();
+	locker.unlock();
+	populateTable();
+}
+
+void PerformanceLog::exportLog() {
+	QString filter = QString("%1 (*.json);;%2 (*.csv)").arg(_("JSON Files")).arg(_("CSV Files"));
+	QString outname = FileDialogs::saveDialog(_("Export Timings..."), _("timings.json"), "outputdir", filter, true, this);
+	if(outname.isEmpty()) {
+		return;
+	}
+	QFile file(outname);
+	if(!file.open(QIODevice::WriteOnly)) {
+		QMessageBox::critical(this, _("Export failed"), _("Check that you have writing permissions in the selected folder."));
+		return;
+	}
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	stream << (QFileInfo(outname).suffix().toLower() == "csv" ? toCsv() : toJson());
+}
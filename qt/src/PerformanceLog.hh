@@ -0,0 +1,104 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * PerformanceLog.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFORMANCELOG_HH
+#define PERFORMANCELOG_HH
+
+#include "common.hh"
+#include "ui_PerformanceDialog.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+
+// Records the wall time and the CPU time of the recognizing thread spent in the individual stages of recognizing each page.
+// Stages may be recorded concurrently from any thread.
+class PerformanceLog : public QDialog {
+	Q_OBJECT
+public:
+	enum Stage {
+		StageRender,    // Rendering the page from the source document
+		StageAdjust,    // Brightness, contrast and invert adjustments
+		StageClassify,  // Blank and duplicate page detection
+		StageDeskew,    // Skew estimation
+		StageLayout,    // Layout analysis
+		StageRoute,     // Script detection for routing the blocks to engines
+		StageRecognize, // Tesseract recognition
+		StageRetry,     // Re-recognition of the lines with a low confidence
+		StageParse,     // Extracting the result from the engine and parsing it into the output format
+		StageInsert,    // Inserting the result into the output editor
+		NumStages
+	};
+	struct StageTime {
+		double wallMsecs = 0.;
+		double cpuMsecs = 0.; // Of the calling thread only, excluding tesseract's own threads and worker processes
+	};
+	// Measures the elapsed wall time and the CPU time of the calling thread
+	class Timer {
+	public:
+		Timer() { restart(); }
+		void restart();
+		StageTime elapsed() const;
+
+	private:
+		QElapsedTimer m_wall;
+		double m_cpuStart;
+	};
+
+	PerformanceLog(QWidget* parent = nullptr);
+
+	// Returns the id under which the stage times of the page are recorded
+	int addPage(const QString& file, int page);
+	void addTime(int id, Stage stage, const StageTime& time);
+	void addTime(int id, Stage stage, const Timer& timer) {
+		addTime(id, stage, timer.elapsed());
+	}
+	// Marks the page as skipped instead of recognized
+	void setSkipped(int id, const QString& reason);
+
+	QString toJson() const;
+	QString toCsv() const;
+
+public slots:
+	void showDialog();
+
+private:
+	struct PageRecord {
+		QString file;
+		int page;
+		StageTime stages[NumStages];
+		QString skipped; // Reason why the page was not recognized, if it was skipped
+	};
+
+	Ui::PerformanceDialog ui;
+	mutable QMutex m_mutex;
+	QList<PageRecord> m_records;
+	int m_firstId = 0; // Id of the first record, ids remain unique across clear() and dropped records
+
+	static QString stageName(Stage stage);
+	static QString stageLabel(Stage stage);
+	static double threadCpuMsecs();
+	void populateTable();
+
+private slots:
+	void clear();
+	void exportLog();
+};
+
+#endif // PERFORMANCELOG_HH
@@ -0,0 +1,723 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * RecognitionPipeline.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <algorithm>
+#include <functional>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+
+#include "ConfidenceRetry.hh"
+#include "CpuBudget.hh"
+#include "Deskew.hh"
+#include "DisplayRenderer.hh"
+#include "DisplayerToolSelect.hh"
+#include "EngineCache.hh"
+#include "JobJournal.hh"
+#include "PageClassifier.hh"
+#include "RecognitionPipeline.hh"
+#include "ResultCache.hh"
+#include "ScriptRouter.hh"
+#include "Utils.hh"
+#include "WorkerProcess.hh"
+
+RecognitionPipeline::ProgressMonitor::ProgressMonitor(int nPages, int nEngines) : MainWindow::ProgressMonitor(nPages), descs(nEngines), weights(nEngines, 1.) {
+	for(ETEXT_DESC& desc : descs) {
+		desc.progress = 0;
+		desc.cancel = cancelCallback;
+		desc.cancel_this = this;
+	}
+}
+
+void RecognitionPipeline::ProgressMonitor::completeArea(double fraction) {
+	QMutexLocker locker(&mMutex);
+	mCompleted += fraction;
+}
+
+int RecognitionPipeline::ProgressMonitor::getProgress() const {
+	QMutexLocker locker(&mMutex);
+	double progress = mCompleted;
+	for(int i = 0, n = descs.size(); i < n; ++i) {
+		progress += weights[i] * descs[i].progress / 100.0;
+	}
+	return std::min(100.0, 100.0 * progress / mTotal);
+}
+
+bool RecognitionPipeline::ProgressMonitor::cancelCallback(void* instance, int /*words*/) {
+	ProgressMonitor* monitor = reinterpret_cast<ProgressMonitor*>(instance);
+	QMutexLocker locker(&monitor->mMutex);
+	return monitor->mCancelled;
+}
+
+class RecognitionPipeline::WorkerThread : public QThread {
+public:
+	WorkerThread(const std::function<void()>& f) : m_f(f) {}
+private:
+	std::function<void()> m_f;
+	void run() override {
+		m_f();
+	}
+};
+
+// Reorder buffer which passes the chunks recognized out of order by the workers
+// to the output in their original page and area sequence.
+class RecognitionPipeline::OrderedOutput {
+public:
+	OrderedOutput(Output& output, ProgressMonitor& monitor, int nPages, JobJournal* journal)
+		: m_output(output), m_monitor(monitor), m_nPages(nPages), m_journal(journal) {}
+	void submit(const Chunk& chunk) {
+		// The progress advances with every finished area, not only once the output reaches the page
+		m_monitor.completeArea(1. / chunk.areaCount);
+		QMutexLocker locker(&m_mutex);
+		m_pending.insert(qMakePair(chunk.pageIdx, chunk.areaIdx), chunk);
+		m_cond.wakeAll();
+	}
+	// Emits the submitted chunks until the last chunk of the last page was emitted
+	void run() {
+		int pageIdx = 0;
+		int areaIdx = 0;
+		QMutexLocker locker(&m_mutex);
+		while(pageIdx < m_nPages) {
+			auto it = m_pending.find(qMakePair(pageIdx, areaIdx));
+			if(it == m_pending.end()) {
+				m_cond.wait(&m_mutex);
+				continue;
+			}
+			Chunk chunk = it.value();
+			m_pending.erase(it);
+			locker.unlock();
+			if(areaIdx == 0) {
+				m_output.beginPage(pageIdx);
+			}
+			if(!chunk.merge) {
+				emitChunk(chunk);
+				journalChunk(chunk);
+			} else {
+				// The blocks of the page are passed on as one chunk once all of them are recognized
+				m_blocks.append(chunk);
+				if(chunk.areaIdx == chunk.areaCount - 1) {
+					Chunk page = mergeBlocks();
+					m_blocks.clear();
+					emitChunk(page);
+					journalChunk(page);
+				}
+			}
+			if(chunk.areaIdx == chunk.areaCount - 1) {
+				m_output.endPage(pageIdx);
+				++pageIdx;
+				areaIdx = 0;
+			} else {
+				++areaIdx;
+			}
+			locker.relock();
+		}
+	}
+
+private:
+	Output& m_output;
+	ProgressMonitor& m_monitor;
+	int m_nPages;
+	JobJournal* m_journal;
+	JobJournal::Page m_journalPage;
+	bool m_journalPageOk = false;
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	QMap<QPair<int, int>, Chunk> m_pending;
+	QList<Chunk> m_blocks;
+
+	Chunk mergeBlocks() const {
+		Chunk page = m_blocks.first();
+		page.areaIdx = 0;
+		page.areaCount = 1;
+		QStringList results;
+		QList<QPoint> offsets;
+		for(const Chunk& block : m_blocks) {
+			// The page is only complete if all its blocks are
+			page.recognized = page.recognized && block.recognized;
+			if(page.error.isEmpty()) {
+				page.error = block.error;
+			}
+			results.append(block.result);
+			offsets.append(block.offset);
+		}
+		if(page.recognized && page.error.isEmpty()) {
+			page.result = OutputEditor::mergeResults(m_output.resultFormat(), page.readData.page, page.pageSize, results, offsets);
+		}
+		return page;
+	}
+
+	void emitChunk(const Chunk& chunk) {
+		if(!chunk.error.isEmpty()) {
+			m_output.readError(chunk.error, chunk.readData);
+		} else if(chunk.recognized && !m_monitor.cancelled()) {
+			if(chunk.built) {
+				m_output.readBuiltResult(chunk.built, chunk.readData);
+			} else {
+				m_output.readResult(chunk.result, chunk.readData);
+			}
+		}
+	}
+	void journalChunk(const Chunk& chunk) {
+		// A page is journaled once all its areas are recognized. Pages resumed from the journal are already in it.
+		if(!m_journal || m_journal->contains(chunk.pageIdx)) {
+			return;
+		}
+		if(chunk.areaIdx == 0) {
+			m_journalPage.angle = chunk.readData.angle;
+			m_journalPage.results.clear();
+			m_journalPageOk = true;
+		}
+		m_journalPageOk = m_journalPageOk && chunk.recognized && chunk.error.isEmpty();
+		m_journalPage.results.append(chunk.result);
+		if(chunk.areaIdx == chunk.areaCount - 1 && m_journalPageOk) {
+			m_journal->append(chunk.pageIdx, m_journalPage);
+		}
+	}
+};
+
+RecognitionPipeline::RecognitionPipeline(const QList<PageJob>& jobs, const Options& options, EngineCache& engineCache, Output& output)
+	: m_jobs(jobs), m_options(options), m_engineCache(engineCache), m_output(output), m_monitor(std::max(1, jobs.size()), workerCount(jobs, options)) {
+	m_options.routing = routingEnabled(options);
+	m_splitBlocks = splitBlocks(jobs, m_options);
+	m_nWorkers = workerCount(jobs, m_options);
+}
+
+bool RecognitionPipeline::routingEnabled(const Options& options) {
+	// Routing only pays off if the selected languages are written in different scripts
+	return options.routing && ScriptRouter(options.settings.language).enabled();
+}
+
+bool RecognitionPipeline::splitBlocks(const QList<PageJob>& jobs, const Options& options) {
+	// Multilingual areas are recognized with the selected languages of their script only. Entire pages are
+	// split into their text blocks for this, whose results are merged into one page again.
+	return routingEnabled(options) && !options.autodetectLayout && (jobs.isEmpty() || jobs.first().ocrAreas.isEmpty());
+}
+
+int RecognitionPipeline::workerCount(const QList<PageJob>& jobs, const Options& options) {
+	// The areas of a page are recognized concurrently too, so a single page can keep several workers busy
+	int nAreas = jobs.isEmpty() ? 1 : std::max(1, jobs.first().ocrAreas.size());
+	int nChunks = options.autodetectLayout || splitBlocks(jobs, options) ? options.threads : jobs.size() * nAreas;
+	return std::max(1, std::min(options.threads, nChunks));
+}
+
+void RecognitionPipeline::applyEngineSettings(tesseract::TessBaseAPI& tess, const EngineSettings& settings) {
+	tess.SetPageSegMode(static_cast<tesseract::PageSegMode>(settings.psm));
+	tess.SetVariable("tessedit_char_whitelist", settings.charWhitelist.toLocal8Bit());
+	tess.SetVariable("tessedit_char_blacklist", settings.charBlacklist.toLocal8Bit());
+}
+
+QByteArray RecognitionPipeline::resultCacheKey(const QImage& image, const EngineSettings& settings, const QString& formatId, int page, int resolution) {
+	// The output determines the result format, the page number is part of the hOCR output
+	QStringList values = {
+		QString(tesseract::TessBaseAPI::Version()), settings.language, QString::number(settings.oem), settings.datapath, QString::number(settings.psm),
+		settings.charWhitelist, settings.charBlacklist, QString::number(settings.retryConfidence), formatId,
+		QString::number(page), QString::number(resolution)
+	};
+	return ResultCache::computeKey(image, values.join("\n").toUtf8());
+}
+
+void RecognitionPipeline::addTime(int timingId, PerformanceLog::Stage stage, const PerformanceLog::Timer& timer) const {
+	if(m_options.performanceLog) {
+		m_options.performanceLog->addTime(timingId, stage, timer);
+	}
+}
+
+RecognitionPipeline::Outcome RecognitionPipeline::run() {
+	Outcome outcome;
+	const EngineSettings& settings = m_options.settings;
+	ScriptRouter router(settings.language);
+	bool routing = m_options.routing;
+	// Keep the engines of all routes and the script detection warm
+	m_engineCache.setMaxKeys(routing ? router.routes().size() + 1 : 2);
+	m_engineCache.setMaxIdlePerKey(m_options.threads);
+	bool ok = false;
+	EngineCache::Engine tess = m_engineCache.acquire(settings.language, settings.oem, settings.datapath, &ok);
+	if(!ok) {
+		outcome.initFailed = true;
+		return outcome;
+	}
+
+	// Blank and duplicate pages are detected across the pages of the job
+	PageClassifier classifier(m_options.skipBlank, m_options.skipDuplicates);
+	JobJournal* journal = m_options.journal;
+	ResultCache* resultCache = m_options.resultCache;
+	int nWorkers = m_nWorkers;
+	int nPages = m_jobs.size();
+	// Rendering a page is considerably cheaper than recognizing it
+	int nRenderers = std::max(1, std::min(nWorkers / 4, nPages));
+	int pageTimeout = m_options.pageTimeout;
+	Config::TimeoutPolicy timeoutPolicy = m_options.timeoutPolicy;
+	WorkerProcess::Request processRequest = {
+		settings.language, settings.oem, settings.datapath, settings.psm, settings.charWhitelist, settings.charBlacklist,
+		m_output.resultFormat(), 0, 0, false, pageTimeout
+	};
+	if(m_options.processes) {
+		tess.release();
+	}
+	ProgressMonitor& monitor = m_monitor;
+	OrderedOutput output(m_output, monitor, nPages, journal);
+	Utils::AsyncQueue<Chunk> queue;
+	// Limit the number of rendered areas waiting to be recognized
+	QSemaphore slots(2 * nWorkers);
+	QMutex renderMutex;
+	int nextJob = 0;
+	// The budget lets the workers recognize concurrently as long as it pays off
+	CpuBudget& budget = CpuBudget::instance();
+	budget.beginBatch(nWorkers);
+	// The timeout bounds the recognition of a page, which starts when a worker picks up its first area
+	QElapsedTimer clock;
+	clock.start();
+	QVector<qint64> pageStarts(nPages, -1);
+
+	// Render stage: render the pages, determine the areas to recognize and pass them to the recognition stage
+	QList<WorkerThread*> renderers;
+	for(int i = 0; i < nRenderers; ++i) {
+		renderers.append(new WorkerThread([&] {
+			CpuBudget::setThreadShare(budget.share(nWorkers + nRenderers));
+			std::unique_ptr<DisplayRenderer> renderer;
+			while(true) {
+				QMutexLocker locker(&renderMutex);
+				int pageIdx = nextJob++;
+				locker.unlock();
+				if(pageIdx >= nPages) {
+					break;
+				}
+				const PageJob& job = m_jobs[pageIdx];
+				bool journaled = journal && journal->contains(pageIdx);
+				QList<QImage> images;
+				QStringList results;
+				QList<QPoint> offsets;
+				QSize pageSize;
+				double angle = job.render.angle;
+				// Journaled and skipped pages are not recognized, their results are passed straight to the output
+				bool direct = journaled;
+				if(!monitor.cancelled() && !job.render.file.isEmpty() && (!journaled || classifier.skipDuplicates())) {
+					if(!renderer || renderer->getFilename() != job.render.file) {
+						renderer.reset(DisplayRenderer::create(job.render.file, job.render.password));
+					}
+				}
+				if(journaled) {
+					// Recognized in a previous run of the job
+					angle = journal->page(pageIdx).angle;
+					results = journal->page(pageIdx).results;
+					if(renderer && classifier.skipDuplicates() && !monitor.cancelled()) {
+						// The remaining pages may duplicate the resumed page
+						seedClassifier(pageIdx, renderer.get(), classifier);
+					}
+				} else if(!monitor.cancelled() && !job.render.file.isEmpty()) {
+					QString skipped;
+					images = renderOCRAreas(pageIdx, renderer.get(), classifier, angle, skipped, offsets, pageSize);
+					if(!skipped.isEmpty()) {
+						direct = true;
+						results.append(skipped);
+						locker.relock();
+						outcome.skipped.append(pageIdx);
+						locker.unlock();
+					}
+				}
+				// Pages which were not classified must not hold up the classification of the subsequent pages
+				classifier.pass(pageIdx);
+
+				Chunk chunk;
+				chunk.pageIdx = pageIdx;
+				chunk.areaIdx = 0;
+				chunk.areaCount = 1;
+				chunk.resolution = job.render.resolution;
+				chunk.recognized = false;
+				chunk.readData.prependFile = false;
+				chunk.readData.prependPage = false;
+				chunk.readData.file = job.render.file;
+				chunk.readData.page = job.render.page;
+				chunk.readData.angle = angle;
+				chunk.readData.resolution = job.render.resolution;
+				chunk.readData.timingId = job.timingId;
+				chunk.route = false;
+				chunk.merge = false;
+				if(images.isEmpty() && !direct) {
+					// Nothing to recognize, pass a placeholder straight to the output so that it does not wait for this page
+					if(!monitor.cancelled()) {
+						locker.relock();
+						outcome.failures.append(qMakePair(pageIdx, _("failed to render page")));
+						locker.unlock();
+						chunk.error = _("\n[Failed to recognize page %1]\n").arg(job.render.page);
+					}
+					output.submit(chunk);
+					continue;
+				}
+				for(int j = 0, n = direct ? results.size() : images.size(); j < n; ++j) {
+					chunk.areaIdx = j;
+					chunk.areaCount = n;
+					chunk.readData.prependPage = m_options.prependPage && j == 0;
+					chunk.readData.prependFile = m_options.prependFile && (chunk.readData.prependPage || (job.newFile && j == 0));
+					if(direct) {
+						chunk.result = results[j];
+						chunk.recognized = true;
+						output.submit(chunk);
+					} else {
+						chunk.image = images[j];
+						chunk.route = routing;
+						chunk.merge = m_splitBlocks;
+						chunk.offset = m_splitBlocks ? offsets[j] : QPoint();
+						chunk.pageSize = pageSize;
+						slots.acquire();
+						queue.enqueue(chunk);
+					}
+				}
+			}
+		}));
+		renderers.back()->start();
+	}
+
+	// Recognition stage
+	QList<WorkerThread*> workers;
+	for(int i = 0; i < nWorkers; ++i) {
+		workers.append(new WorkerThread([&, i] {
+			// Either recognize in this process, or pass the chunks on to a worker process
+			EngineCache::Engine engine;
+			QString engineLanguage = settings.language;
+			std::unique_ptr<WorkerProcess> process;
+			if(m_options.processes) {
+				process.reset(new WorkerProcess());
+			} else if(i == 0) {
+				engine = std::move(tess);
+			} else {
+				bool engineOk = false;
+				engine = m_engineCache.acquire(settings.language, settings.oem, settings.datapath, &engineOk);
+				if(!engineOk) {
+					// Leave the queued chunks to the remaining workers
+					return;
+				}
+			}
+			if(engine) {
+				applyEngineSettings(*engine, settings);
+				m_output.prepareEngine(*engine);
+			}
+			while(true) {
+				Chunk chunk = queue.dequeue();
+				if(chunk.pageIdx < 0) {
+					break;
+				}
+				EngineSettings chunkSettings = settings;
+				if(chunk.route && !monitor.cancelled()) {
+					PerformanceLog::Timer timer;
+					chunk.language = router.route(m_engineCache, chunk.image, chunk.resolution);
+					addTime(chunk.readData.timingId, PerformanceLog::StageRoute, timer);
+					chunkSettings.language = chunk.language;
+				}
+				bool engineOk = true;
+				if(engine && chunkSettings.language != engineLanguage && !monitor.cancelled()) {
+					// Switch to an engine with the routed languages, or back to the selected ones if it cannot be initialized
+					engine = m_engineCache.acquire(chunkSettings.language, settings.oem, settings.datapath, &engineOk);
+					if(!engineOk) {
+						chunkSettings.language = settings.language;
+						engine = m_engineCache.acquire(settings.language, settings.oem, settings.datapath, &engineOk);
+					}
+					if(engineOk) {
+						engineLanguage = chunkSettings.language;
+						applyEngineSettings(*engine, settings);
+						m_output.prepareEngine(*engine);
+					} else {
+						// Try again for the next chunk
+						engineLanguage.clear();
+						QMutexLocker locker(&renderMutex);
+						outcome.failures.append(qMakePair(chunk.pageIdx, _("failed to initialize tesseract")));
+						chunk.error = _("\n[Failed to recognize page %1]\n").arg(m_jobs[chunk.pageIdx].render.page);
+					}
+				}
+				QByteArray cacheKey;
+				if(engineOk && !monitor.cancelled() && resultCache && resultCache->enabled()) {
+					cacheKey = resultCacheKey(chunk.image, chunkSettings, m_output.formatId(), chunk.readData.page, chunk.resolution);
+					chunk.recognized = resultCache->lookup(cacheKey, chunk.result);
+				}
+				if(engineOk && !monitor.cancelled() && !chunk.recognized) {
+					monitor.weights[i] = 1. / chunk.areaCount;
+					// Recognizes the chunk in this process or in the worker process, optionally with a fallback segmentation mode
+					auto attempt = [&](const QImage& image, int resolution, int fallbackPsm, qint64 deadline) {
+						WorkerProcess::Status status;
+						// The areas of a page share the time remaining until the deadline of the page
+						int remaining = 0;
+						if(pageTimeout > 0) {
+							remaining = int(std::max(qint64(0), deadline - clock.elapsed()));
+							if(remaining == 0) {
+								return WorkerProcess::Status::TimedOut;
+							}
+						}
+						monitor.desc(i).progress = 0;
+						PerformanceLog::Timer timer;
+						if(process) {
+							WorkerProcess::Request request = processRequest;
+							request.language = chunkSettings.language;
+							request.page = chunk.readData.page;
+							request.resolution = resolution;
+							request.forcePsm = fallbackPsm >= 0;
+							request.psm = request.forcePsm ? fallbackPsm : request.psm;
+							request.timeout = remaining;
+							status = process->recognize(request, image, monitor.desc(i), chunk.result);
+							if(status == WorkerProcess::Status::Crashed && !monitor.cancelled()) {
+								// Retry once on a new worker process before giving up on the page
+								status = process->recognize(request, image, monitor.desc(i), chunk.result);
+							}
+							addTime(chunk.readData.timingId, PerformanceLog::StageRecognize, timer);
+						} else {
+							if(fallbackPsm >= 0) {
+								engine->SetPageSegMode(static_cast<tesseract::PageSegMode>(fallbackPsm));
+							}
+							Utils::setOcrImage(*engine, image);
+							engine->SetSourceResolution(resolution);
+							if(pageTimeout > 0) {
+								monitor.desc(i).set_deadline_msecs(remaining);
+							}
+							engine->Recognize(&monitor.desc(i));
+							addTime(chunk.readData.timingId, PerformanceLog::StageRecognize, timer);
+							if(monitor.cancelled()) {
+								status = WorkerProcess::Status::Cancelled;
+							} else if(pageTimeout > 0 && monitor.desc(i).deadline_exceeded()) {
+								status = WorkerProcess::Status::TimedOut;
+							} else {
+								timer.restart();
+								// The output builds its result directly, unless the result is still processed as text
+								chunk.built.reset();
+								if(!chunk.merge && settings.retryConfidence == 0) {
+									chunk.built = m_output.buildResult(*engine, chunk.readData.page, image.size());
+								}
+								if(!chunk.built) {
+									chunk.result = m_output.extractResult(*engine, chunk.readData.page);
+								}
+								addTime(chunk.readData.timingId, PerformanceLog::StageParse, timer);
+								status = WorkerProcess::Status::Ok;
+							}
+							if(fallbackPsm >= 0) {
+								applyEngineSettings(*engine, settings);
+								m_output.prepareEngine(*engine);
+							}
+						}
+						monitor.desc(i).progress = 0;
+						return status;
+					};
+					qint64 deadline = 0;
+					if(pageTimeout > 0) {
+						QMutexLocker locker(&renderMutex);
+						if(pageStarts[chunk.pageIdx] < 0) {
+							pageStarts[chunk.pageIdx] = clock.elapsed();
+						}
+						deadline = pageStarts[chunk.pageIdx] + pageTimeout;
+					}
+					budget.acquireBatchSlot();
+					WorkerProcess::Status status = attempt(chunk.image, chunk.resolution, -1, deadline);
+					// The fallbacks of the areas of a page share one more timeout
+					qint64 fallbackDeadline = deadline + pageTimeout;
+					// The blocks of a merged page share the resolution of the page, they are retried with sparse text segmentation instead
+					Config::TimeoutPolicy policy = chunk.merge && timeoutPolicy == Config::TimeoutPolicy::LowerResolution ? Config::TimeoutPolicy::SparseText : timeoutPolicy;
+					bool fallback = status == WorkerProcess::Status::TimedOut && policy != Config::TimeoutPolicy::Skip;
+					if(fallback && policy == Config::TimeoutPolicy::LowerResolution) {
+						// The result then refers to the downscaled image, hence the page also gets the lower resolution
+						QImage scaled = Utils::ocrImage(chunk.image.scaled(chunk.image.size() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+						chunk.resolution /= 2;
+						chunk.readData.resolution = chunk.resolution;
+						status = attempt(scaled, chunk.resolution, -1, fallbackDeadline);
+					} else if(fallback && policy == Config::TimeoutPolicy::SparseText) {
+						status = attempt(chunk.image, chunk.resolution, tesseract::PSM_SPARSE_TEXT, fallbackDeadline);
+					}
+					if(status == WorkerProcess::Status::Ok && !fallback && settings.retryConfidence > 0) {
+						// Second pass over the poorly recognized lines. Not after a fallback, whose result may not refer to the chunk image.
+						ETEXT_DESC desc;
+						desc.cancel = ProgressMonitor::cancelCallback;
+						desc.cancel_this = &monitor;
+						auto recognizeLine = [&](const QImage& image, int psm, int resolution) {
+							QString result;
+							if(process) {
+								WorkerProcess::Request request = processRequest;
+								request.language = chunkSettings.language;
+								request.page = chunk.readData.page;
+								request.resolution = resolution;
+								request.forcePsm = true;
+								request.psm = psm;
+								if(process->recognize(request, image, desc, result) != WorkerProcess::Status::Ok) {
+									result.clear();
+								}
+							} else {
+								engine->SetPageSegMode(static_cast<tesseract::PageSegMode>(psm));
+								Utils::setOcrImage(*engine, image);
+								engine->SetSourceResolution(resolution);
+								engine->Recognize(&desc);
+								if(!monitor.cancelled()) {
+									result = m_output.extractResult(*engine, chunk.readData.page);
+								}
+							}
+							return result;
+						};
+						PerformanceLog::Timer timer;
+						chunk.result = ConfidenceRetry::improve(chunk.result, chunk.image, chunk.resolution, settings.retryConfidence, recognizeLine);
+						addTime(chunk.readData.timingId, PerformanceLog::StageRetry, timer);
+						if(engine) {
+							applyEngineSettings(*engine, settings);
+							m_output.prepareEngine(*engine);
+						}
+						if(monitor.cancelled()) {
+							status = WorkerProcess::Status::Cancelled;
+						}
+					}
+					budget.releaseBatchSlot(status == WorkerProcess::Status::Ok);
+					if(status == WorkerProcess::Status::Ok) {
+						chunk.recognized = true;
+						QMutexLocker locker(&renderMutex);
+						outcome.recognizedPages += 1. / chunk.areaCount;
+						locker.unlock();
+						// The cache and the journal store the text of built results
+						if(chunk.built && ((!cacheKey.isEmpty() && !fallback) || journal)) {
+							chunk.result = chunk.built->toString();
+						}
+						// Fallback results do not correspond to the settings in the cache key
+						if(!cacheKey.isEmpty() && !fallback) {
+							resultCache->insert(cacheKey, chunk.result);
+						}
+					} else if(status != WorkerProcess::Status::Cancelled) {
+						QString reason = _("failed to start the recognition process");
+						if(status == WorkerProcess::Status::TimedOut) {
+							reason = fallback ? _("recognition timed out, also after retrying") : _("recognition timed out, page skipped");
+						} else if(status == WorkerProcess::Status::Crashed) {
+							reason = _("the recognition process crashed");
+						}
+						QMutexLocker locker(&renderMutex);
+						outcome.failures.append(qMakePair(chunk.pageIdx, reason));
+						chunk.error = _("\n[Failed to recognize page %1]\n").arg(m_jobs[chunk.pageIdx].render.page);
+					}
+				}
+				chunk.image = QImage();
+				output.submit(chunk);
+				slots.release();
+			}
+		}));
+		workers.back()->start();
+	}
+
+	// Output stage: runs on this thread, since every page eventually yields its last chunk
+	output.run();
+
+	for(WorkerThread* renderer : renderers) {
+		renderer->wait();
+	}
+	qDeleteAll(renderers);
+	for(int i = 0; i < nWorkers; ++i) {
+		Chunk quit;
+		quit.pageIdx = -1;
+		queue.enqueue(quit);
+	}
+	for(WorkerThread* worker : workers) {
+		worker->wait();
+	}
+	qDeleteAll(workers);
+	budget.endBatch();
+	if(resultCache) {
+		resultCache->sync();
+	}
+	return outcome;
+}
+
+QImage RecognitionPipeline::proxyImage(const QImage& image, int resolution, int proxyResolution) {
+	double scale = double(proxyResolution) / resolution;
+	return scale < 1. ? image.scaled(qRound(image.width() * scale), qRound(image.height() * scale), Qt::IgnoreAspectRatio, Qt::SmoothTransformation) : image;
+}
+
+void RecognitionPipeline::seedClassifier(int pageIdx, DisplayRenderer* renderer, PageClassifier& classifier) const {
+	const PageJob& job = m_jobs[pageIdx];
+	QImage image = renderer->renderNative(job.render.page, job.render.resolution);
+	if(!image.isNull()) {
+		renderer->adjustImage(image, job.render.brightness, job.render.contrast, job.render.invert);
+		PerformanceLog::Timer timer;
+		classifier.classify(pageIdx, proxyImage(image, job.render.resolution, DisplayerToolSelect::layoutResolution(job.render.resolution)));
+		addTime(job.timingId, PerformanceLog::StageClassify, timer);
+	}
+}
+
+QList<QImage> RecognitionPipeline::renderOCRAreas(int pageIdx, DisplayRenderer* renderer, PageClassifier& classifier, double& angle, QString& skipped, QList<QPoint>& offsets, QSize& pageSize) const {
+	const PageJob& job = m_jobs[pageIdx];
+	QList<QImage> images;
+	PerformanceLog::Timer timer;
+	// Bitonal and grayscale pages are passed to tesseract as such, which saves memory and tesseract's own conversion
+	QImage image = renderer->renderNative(job.render.page, job.render.resolution);
+	addTime(job.timingId, PerformanceLog::StageRender, timer);
+	if(image.isNull()) {
+		return images;
+	}
+	timer.restart();
+	renderer->adjustImage(image, job.render.brightness, job.render.contrast, job.render.invert);
+	addTime(job.timingId, PerformanceLog::StageAdjust, timer);
+	angle = job.render.angle;
+	QList<QRectF> areas = job.ocrAreas;
+	if(job.deskew || m_options.autodetectLayout || m_splitBlocks || classifier.enabled()) {
+		// Classification, deskewing and layout analysis work on a downscaled proxy, only the resulting areas are extracted at full resolution
+		int proxyResolution = DisplayerToolSelect::layoutResolution(job.render.resolution);
+		QImage proxy = proxyImage(image, job.render.resolution, proxyResolution);
+		if(classifier.enabled()) {
+			timer.restart();
+			int original = -1;
+			PageClassifier::Verdict verdict = classifier.classify(pageIdx, proxy, &original);
+			addTime(job.timingId, PerformanceLog::StageClassify, timer);
+			if(verdict != PageClassifier::Verdict::Recognize) {
+				// The skipped page has the size the recognized page would have had
+				QSize size = Displayer::getSceneBoundingRect(image.size(), angle).size().toSize();
+				OutputEditor::ResultFormat format = m_output.resultFormat();
+				if(verdict == PageClassifier::Verdict::Blank) {
+					skipped = OutputEditor::skippedResult(format, job.render.page, size, "blank", _("blank page"));
+					if(m_options.performanceLog) {
+						m_options.performanceLog->setSkipped(job.timingId, "blank");
+					}
+				} else {
+					const Displayer::RenderSettings& originalPage = m_jobs[original].render;
+					skipped = OutputEditor::skippedResult(format, job.render.page, size, QString("duplicate %1").arg(originalPage.page),
+					                                      _("duplicate of %1 [%2]").arg(QFileInfo(originalPage.file).fileName()).arg(originalPage.page));
+					if(m_options.performanceLog) {
+						m_options.performanceLog->setSkipped(job.timingId, "duplicate");
+					}
+				}
+				return images;
+			}
+		}
+		if(job.deskew) {
+			timer.restart();
+			angle = Deskew::estimateAngle(proxy, angle);
+			addTime(job.timingId, PerformanceLog::StageDeskew, timer);
+		}
+		if(m_options.autodetectLayout || m_splitBlocks) {
+			timer.restart();
+			areas = DisplayerToolSelect::analyzeLayout(proxy, proxyResolution, job.render.resolution, angle);
+			addTime(job.timingId, PerformanceLog::StageLayout, timer);
+		}
+	}
+	QRectF sceneRect = Displayer::getSceneBoundingRect(image.size(), angle);
+	if(areas.isEmpty()) {
+		areas.append(sceneRect);
+	}
+	pageSize = sceneRect.size().toSize();
+	for(const QRectF& area : areas) {
+		images.append(Displayer::getImage(image, angle, area));
+		offsets.append((area.topLeft() - sceneRect.topLeft()).toPoint());
+	}
+	return images;
+}
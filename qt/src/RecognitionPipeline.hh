@@ -0,0 +1,191 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * RecognitionPipeline.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RECOGNITIONPIPELINE_HH
+#define RECOGNITIONPIPELINE_HH
+
+#include <QImage>
+#include <QList>
+#include <QPair>
+#include <QPoint>
+#include <QRectF>
+#include <QSize>
+#include <QStringList>
+#include <memory>
+#include <vector>
+#define USE_STD_NAMESPACE
+#include <tesseract/ocrclass.h>
+#undef USE_STD_NAMESPACE
+
+#include "Config.hh"
+#include "Displayer.hh"
+#include "MainWindow.hh"
+#include "OutputEditor.hh"
+#include "PerformanceLog.hh"
+
+namespace tesseract {
+class TessBaseAPI;
+}
+class DisplayRenderer;
+class EngineCache;
+class JobJournal;
+class PageClassifier;
+class ResultCache;
+
+// Recognizes a list of pages in three stages: renderer threads render the pages and determine the areas to recognize,
+// worker threads recognize the areas, and the output stage passes the results on in page order. Used both by the
+// interactive recognition and by the batch subcommand, which differ in where the results go.
+class RecognitionPipeline {
+public:
+	struct EngineSettings {
+		QString language;
+		int oem; // tesseract::OcrEngineMode
+		QString datapath; // Traineddata variant of the profile, empty for the installed traineddata
+		int psm;
+		QString charWhitelist;
+		QString charBlacklist;
+		int retryConfidence; // Lines with words below this confidence are re-recognized, zero for none
+	};
+	struct PageJob {
+		Displayer::RenderSettings render;
+		QList<QRectF> ocrAreas; // Empty for the entire page
+		bool deskew; // Straighten the page before determining the areas
+		bool newFile;
+		int timingId; // Id of the page in the performance log, -1 for none
+	};
+	struct Options {
+		EngineSettings settings;
+		bool autodetectLayout = false;
+		bool routing = false; // Route multilingual areas to the selected languages of their script, requires the osd traineddata
+		bool prependFile = false;
+		bool prependPage = false;
+		bool skipBlank = false;
+		bool skipDuplicates = false;
+		int threads = 1;
+		bool processes = false; // Recognize in worker processes
+		int pageTimeout = 0; // In milliseconds, zero for none. Bounds all areas of a page together, their timeout fallbacks get one more.
+		Config::TimeoutPolicy timeoutPolicy = Config::TimeoutPolicy::Skip;
+		ResultCache* resultCache = nullptr;
+		JobJournal* journal = nullptr; // Pages contained in the journal are not recognized again
+		PerformanceLog* performanceLog = nullptr;
+	};
+	// Receives the results. The read and page functions are called in page order on the thread running the pipeline,
+	// the engine functions concurrently from the worker threads.
+	class Output {
+	public:
+		virtual ~Output() = default;
+		virtual OutputEditor::ResultFormat resultFormat() const = 0;
+		// Identifies the representation of the results, for the result cache
+		virtual QString formatId() const = 0;
+		virtual void prepareEngine(tesseract::TessBaseAPI& tess) const {
+			OutputEditor::prepareEngine(tess, resultFormat());
+		}
+		virtual QString extractResult(tesseract::TessBaseAPI& tess, int page) const {
+			return OutputEditor::extractResult(tess, resultFormat(), page);
+		}
+		virtual std::shared_ptr<OutputEditor::Result> buildResult(tesseract::TessBaseAPI& /*tess*/, int /*page*/, const QSize& /*size*/) const {
+			return nullptr;
+		}
+		virtual void beginPage(int /*pageIdx*/) {}
+		virtual void readResult(const QString& result, const OutputEditor::ReadSessionData& data) = 0;
+		virtual void readBuiltResult(const std::shared_ptr<OutputEditor::Result>& result, const OutputEditor::ReadSessionData& data) {
+			readResult(result->toString(), data);
+		}
+		virtual void readError(const QString& errorMsg, const OutputEditor::ReadSessionData& data) = 0;
+		virtual void endPage(int /*pageIdx*/) {}
+	};
+	class ProgressMonitor : public MainWindow::ProgressMonitor {
+	public:
+		std::vector<ETEXT_DESC> descs;
+		std::vector<double> weights; // Fraction of a page recognized by each engine
+
+		ProgressMonitor(int nPages, int nEngines = 1);
+		ETEXT_DESC& desc(int engine = 0) {
+			return descs[engine];
+		}
+		// Credits a finished area, i.e. the given fraction of its page
+		void completeArea(double fraction);
+		int getProgress() const override;
+		static bool cancelCallback(void* instance, int /*words*/);
+
+	private:
+		double mCompleted = 0.; // Pages recognized, including the finished areas of partially recognized pages
+	};
+	struct Outcome {
+		bool initFailed = false; // No engine could be initialized, nothing was recognized
+		QList<QPair<int, QString>> failures; // Index of the page and the reason it failed
+		QList<int> skipped; // Indices of the blank and duplicate pages
+		double recognizedPages = 0.; // Pages recognized by tesseract, i.e. neither resumed, skipped nor cached
+	};
+
+	RecognitionPipeline(const QList<PageJob>& jobs, const Options& options, EngineCache& engineCache, Output& output);
+	ProgressMonitor* monitor() {
+		return &m_monitor;
+	}
+	// Runs the pipeline to completion on the calling thread
+	Outcome run();
+
+	// Always sets all variables, the engine may have been used with different settings before
+	static void applyEngineSettings(tesseract::TessBaseAPI& tess, const EngineSettings& settings);
+	static QByteArray resultCacheKey(const QImage& image, const EngineSettings& settings, const QString& formatId, int page, int resolution);
+
+private:
+	class WorkerThread;
+	class OrderedOutput;
+	struct Chunk {
+		int pageIdx;
+		int areaIdx;
+		int areaCount;
+		QImage image;
+		int resolution;
+		bool recognized;
+		QString result;
+		std::shared_ptr<OutputEditor::Result> built; // Result built by the output, if any
+		QString error;
+		OutputEditor::ReadSessionData readData;
+		bool route; // Recognize with the selected languages of the script of the image only
+		bool merge; // The areas are blocks of the page which are merged into one result
+		QString language; // Languages the chunk was routed to
+		QPoint offset; // Position of the block on the page
+		QSize pageSize;
+	};
+
+	QList<PageJob> m_jobs;
+	Options m_options;
+	EngineCache& m_engineCache;
+	Output& m_output;
+	bool m_splitBlocks;
+	int m_nWorkers;
+	ProgressMonitor m_monitor;
+
+	static bool routingEnabled(const Options& options);
+	static bool splitBlocks(const QList<PageJob>& jobs, const Options& options);
+	static int workerCount(const QList<PageJob>& jobs, const Options& options);
+	// Downscales the page to the resolution of the proxy which is classified, deskewed and analyzed
+	static QImage proxyImage(const QImage& image, int resolution, int proxyResolution);
+	void addTime(int timingId, PerformanceLog::Stage stage, const PerformanceLog::Timer& timer) const;
+	// Classifies a page resumed from the journal, so that the remaining pages can be detected as its duplicates
+	void seedClassifier(int pageIdx, DisplayRenderer* renderer, PageClassifier& classifier) const;
+	// Renders the areas to recognize of a page. If the classifier skips the page, no areas but the result for the skipped page are returned.
+	// With splitBlocks, an entire page is split into its text blocks, whose offsets and the size of the page are returned.
+	QList<QImage> renderOCRAreas(int pageIdx, DisplayRenderer* renderer, PageClassifier& classifier, double& angle, QString& skipped, QList<QPoint>& offsets, QSize& pageSize) const;
+};
+
+#endif // RECOGNITIONPIPELINE_HH
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * RecognitionProfile.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QSettings>
+#include <algorithm>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+
+#include "DisplayRenderer.hh"
+#include "RecognitionProfile.hh"
+#include "Utils.hh"
+#include "common.hh"
+
+// The measured throughput covers about this many of the most recently recognized pages
+static const double THROUGHPUT_WINDOW_PAGES = 100.;
+
+const QList<RecognitionProfile>& RecognitionProfile::profiles() {
+	// tessdata_best only contains LSTM models, tessdata_fast is the integerized and smaller variant of them
+#if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 0, 0)
+	static const QList<RecognitionProfile> profiles = {
+		{Id::Fast, "fast", _("Fast"), "fast", "tessdata_fast", tesseract::OEM_LSTM_ONLY, tesseract::PSM_SINGLE_BLOCK, 0, 200},
+		{Id::Balanced, "balanced", _("Balanced"), "", "", tesseract::OEM_DEFAULT, tesseract::PSM_AUTO, 0, 0},
+		{Id::Best, "best", _("Best"), "best", "tessdata_best", tesseract::OEM_LSTM_ONLY, tesseract::PSM_AUTO, 300, 0}
+	};
+#else
+	static const QList<RecognitionProfile> profiles = {
+		{Id::Fast, "fast", _("Fast"), "", "", tesseract::OEM_DEFAULT, tesseract::PSM_SINGLE_BLOCK, 0, 200},
+		{Id::Balanced, "balanced", _("Balanced"), "", "", tesseract::OEM_DEFAULT, tesseract::PSM_AUTO, 0, 0},
+		{Id::Best, "best", _("Best"), "", "", tesseract::OEM_DEFAULT, tesseract::PSM_AUTO, 300, 0}
+	};
+#endif
+	return profiles;
+}
+
+const RecognitionProfile& RecognitionProfile::get(Id id) {
+	return profiles()[static_cast<int>(id)];
+}
+
+const RecognitionProfile* RecognitionProfile::find(const QString& name) {
+	for(const RecognitionProfile& profile : profiles()) {
+		if(profile.name == name) {
+			return &profile;
+		}
+	}
+	return nullptr;
+}
+
+QString RecognitionProfile::modelPath(const QString& tessdataDir, const QString& language) const {
+	if(modelSet.isEmpty() || tessdataDir.isEmpty()) {
+		return QString();
+	}
+	QDir dir(QDir(tessdataDir).absoluteFilePath(modelSet));
+	for(const QString& lang : language.split('+', QString::SkipEmptyParts)) {
+		if(!dir.exists(lang + ".traineddata")) {
+			return QString();
+		}
+	}
+	// Same form as the datapath reported by tesseract
+	return dir.absolutePath() + "/";
+}
+
+QStringList RecognitionProfile::installedLanguages(const QString& tessdataDir) const {
+	QStringList languages;
+	if(modelSet.isEmpty() || tessdataDir.isEmpty()) {
+		return languages;
+	}
+	QDir dir(QDir(tessdataDir).absoluteFilePath(modelSet));
+	for(const QString& subdir : QStringList {"", "script/"}) {
+		for(const QString& file : QDir(dir.absoluteFilePath(subdir)).entryList({"*.traineddata"}, QDir::Files)) {
+			languages.append(subdir + file.left(file.indexOf('.')));
+		}
+	}
+	return languages;
+}
+
+int RecognitionProfile::resolution(const QString& filename, int resolution) const {
+	if(!DisplayRenderer::isDocument(filename)) {
+		return resolution;
+	}
+	if(minResolution > 0) {
+		resolution = std::max(resolution, minResolution);
+	}
+	if(maxResolution > 0) {
+		resolution = std::min(resolution, maxResolution);
+	}
+	return resolution;
+}
+
+double RecognitionProfile::pagesPerMinute() const {
+	QSettings settings;
+	double pages = settings.value(QString("profilethroughput/%1/pages").arg(name)).toDouble();
+	double msecs = settings.value(QString("profilethroughput/%1/msecs").arg(name)).toDouble();
+	return msecs > 0. ? pages / msecs * 60000. : 0.;
+}
+
+void RecognitionProfile::addThroughput(double pages, qint64 msecs) const {
+	if(pages <= 0. || msecs <= 0) {
+		return;
+	}
+	QSettings settings;
+	QString pagesKey = QString("profilethroughput/%1/pages").arg(name);
+	QString msecsKey = QString("profilethroughput/%1/msecs").arg(name);
+	double totalPages = settings.value(pagesKey).toDouble() + pages;
+	double totalMsecs = settings.value(msecsKey).toDouble() + msecs;
+	// Scale down the totals rather than keeping the individual jobs, so that older jobs fade out
+	if(totalPages > THROUGHPUT_WINDOW_PAGES) {
+		double scale = THROUGHPUT_WINDOW_PAGES / totalPages;
+		totalPages *= scale;
+		totalMsecs *= scale;
+	}
+	settings.setValue(pagesKey, totalPages);
+	settings.setValue(msecsKey, totalMsecs);
+}
+
+QString RecognitionProfile::throughputLabel() const {
+	double rate = pagesPerMinute();
+	return rate > 0. ? _("%1 (%2 pages/min)").arg(label).arg(rate, 0, 'f', rate < 10. ? 1 : 0) : label;
+}
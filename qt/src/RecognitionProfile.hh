@@ -0,0 +1,64 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * RecognitionProfile.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECOGNITIONPROFILE_HH
+#define RECOGNITIONPROFILE_HH
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Named trade-offs between recognition speed and accuracy. A profile selects the
+// traineddata variant, the engine mode, the bounds for the resolution at which
+// documents are rendered for recognition and the default page segmentation mode.
+class RecognitionProfile {
+public:
+	enum class Id { Fast, Balanced, Best };
+
+	Id id;
+	QString name; // Identifier in the settings and on the command line
+	QString label;
+	QString modelSet; // Subdirectory of the tessdata directory with the traineddata variant, empty for the installed traineddata
+	QString repository; // Repository of the tesseract-ocr project providing the variant
+	int oem; // tesseract::OcrEngineMode
+	int psm; // Default tesseract::PageSegMode
+	int minResolution; // Zero for none
+	int maxResolution; // Zero for none
+
+	static const QList<RecognitionProfile>& profiles();
+	static const RecognitionProfile& get(Id id);
+	static const RecognitionProfile* find(const QString& name);
+
+	// Directory with the traineddata of the profile for all of the '+' separated languages.
+	// Returns an empty string if the profile uses the installed traineddata, or if its variant
+	// is not installed for all the languages.
+	QString modelPath(const QString& tessdataDir, const QString& language) const;
+	// Languages whose traineddata variant is installed
+	QStringList installedLanguages(const QString& tessdataDir) const;
+	// Applies the resolution bounds, to documents only: the resolution of images is a scale factor
+	int resolution(const QString& filename, int resolution) const;
+
+	// Throughput of the recent recognition jobs with this profile, zero if none was measured yet
+	double pagesPerMinute() const;
+	void addThroughput(double pages, qint64 msecs) const;
+	// Label with the measured throughput, if any
+	QString throughputLabel() const;
+};
+
+#endif // RECOGNITIONPROFILE_HH
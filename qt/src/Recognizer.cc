@@ -18,6 +18,9 @@
  */
 
 #include <QClipboard>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QGridLayout>
 #include <QIcon>
 #include <QLabel>
@@ -27,6 +30,7 @@
 #include <csignal>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #define USE_STD_NAMESPACE
 #include <tesseract/baseapi.h>
@@ -43,30 +47,66 @@
 #define pipe(fds) _pipe(fds, 5000, _O_BINARY)
 #endif
 
+#include "ConfidenceRetry.hh"
 #include "ConfigSettings.hh"
+#include "CpuBudget.hh"
 #include "Displayer.hh"
+#include "JobJournal.hh"
 #include "MainWindow.hh"
 #include "OutputEditor.hh"
+#include "PerformanceLog.hh"
+#include "RecognitionProfile.hh"
 #include "Recognizer.hh"
+#include "ResultCache.hh"
 #include "Utils.hh"
 
-class Recognizer::ProgressMonitor : public MainWindow::ProgressMonitor {
+// Passes the results of the pipeline on to the output editor
+class Recognizer::EditorOutput : public RecognitionPipeline::Output {
 public:
-	ETEXT_DESC desc;
-
-	ProgressMonitor(int nPages) : MainWindow::ProgressMonitor(nPages) {
-		desc.progress = 0;
-		desc.cancel = cancelCallback;
-		desc.cancel_this = this;
+	EditorOutput(OutputEditor* editor, const QList<int>& pages) : m_editor(editor), m_pages(pages), m_readSessionData(editor->initRead()) {}
+	~EditorOutput() {
+		m_editor->finalizeRead(m_readSessionData);
+	}
+	OutputEditor::ResultFormat resultFormat() const override {
+		return m_editor->resultFormat();
+	}
+	QString formatId() const override {
+		return m_editor->metaObject()->className();
+	}
+	void prepareEngine(tesseract::TessBaseAPI& tess) const override {
+		m_editor->prepareEngine(tess);
+	}
+	QString extractResult(tesseract::TessBaseAPI& tess, int page) const override {
+		return m_editor->extractResult(tess, page);
+	}
+	std::shared_ptr<OutputEditor::Result> buildResult(tesseract::TessBaseAPI& tess, int page, const QSize& size) const override {
+		return m_editor->buildResult(tess, page, size);
+	}
+	void beginPage(int pageIdx) override {
+		QMetaObject::invokeMethod(MAIN, "pushState", Qt::QueuedConnection, Q_ARG(MainWindow::State, MainWindow::State::Busy), Q_ARG(QString, _("Recognizing page %1 (%2 of %3)").arg(m_pages[pageIdx]).arg(pageIdx + 1).arg(m_pages.size())));
+	}
+	void readResult(const QString& result, const OutputEditor::ReadSessionData& data) override {
+		m_editor->readResult(result, session(data));
+	}
+	void readBuiltResult(const std::shared_ptr<OutputEditor::Result>& result, const OutputEditor::ReadSessionData& data) override {
+		m_editor->readBuiltResult(result, session(data));
 	}
-	int getProgress() const override {
-		QMutexLocker locker(&mMutex);
-		return 100.0 * ((mProgress + desc.progress / 100.0) / mTotal);
+	void readError(const QString& errorMsg, const OutputEditor::ReadSessionData& data) override {
+		m_editor->readError(errorMsg, session(data));
 	}
-	static bool cancelCallback(void* instance, int /*words*/) {
-		ProgressMonitor* monitor = reinterpret_cast<ProgressMonitor*>(instance);
-		QMutexLocker locker(&monitor->mMutex);
-		return monitor->mCancelled;
+	void endPage(int /*pageIdx*/) override {
+		QMetaObject::invokeMethod(MAIN, "popState", Qt::QueuedConnection);
+	}
+
+private:
+	OutputEditor* m_editor;
+	QList<int> m_pages;
+	OutputEditor::ReadSessionData* m_readSessionData;
+
+	OutputEditor::ReadSessionData* session(const OutputEditor::ReadSessionData& data) {
+		// Only assign the common fields, the editor specific session state is preserved
+		static_cast<OutputEditor::ReadSessionData&>(*m_readSessionData) = data;
+		return m_readSessionData;
 	}
 };
 
@@ -91,6 +131,7 @@ Recognizer::Recognizer(const UI_MainWindow& _ui) :
 
 	ui.toolButtonRecognize->setText(QString("%1\n%2").arg(m_modeLabel).arg(m_langLabel));
 	ui.menuLanguages->installEventFilter(this);
+	m_warmTimer.setSingleShot(true);
 
 	connect(ui.toolButtonRecognize, SIGNAL(clicked()), this, SLOT(recognizeButtonClicked()));
 	connect(currentPageAction, SIGNAL(triggered()), this, SLOT(recognizeCurrentPage()));
@@ -98,6 +139,7 @@ Recognizer::Recognizer(const UI_MainWindow& _ui) :
 	connect(m_pagesDialogUi.lineEditPageRange, SIGNAL(textChanged(QString)), this, SLOT(clearLineEditPageRangeStyle()));
 	connect(m_charListDialogUi.radioButtonBlacklist, SIGNAL(toggled(bool)), m_charListDialogUi.lineEditBlacklist, SLOT(setEnabled(bool)));
 	connect(m_charListDialogUi.radioButtonWhitelist, SIGNAL(toggled(bool)), m_charListDialogUi.lineEditWhitelist, SLOT(setEnabled(bool)));
+	connect(&m_warmTimer, SIGNAL(timeout()), this, SLOT(warmEngine()));
 
 	ADD_SETTING(VarSetting<QString>("language", "eng:en_EN"));
 	ADD_SETTING(ComboSetting("ocrregionstrategy", m_pagesDialogUi.comboBoxRecognitionArea, 0));
@@ -108,10 +150,17 @@ Recognizer::Recognizer(const UI_MainWindow& _ui) :
 	ADD_SETTING(SwitchSetting("ocrblacklistenabled", m_charListDialogUi.radioButtonBlacklist, true));
 	ADD_SETTING(SwitchSetting("ocrwhitelistenabled", m_charListDialogUi.radioButtonWhitelist, false));
 	ADD_SETTING(VarSetting<int>("psm", 6));
+	ADD_SETTING(VarSetting<QString>("ocrprofile", "balanced"));
 }
 
 QStringList Recognizer::getAvailableLanguages() const {
-	auto tess = initTesseract();
+	// Any engine can list the available languages. Prefer one for the configured language, since it is likely to be used next.
+	QString language = ConfigSettings::get<VarSetting<QString>>("language")->getValue().split(":").first();
+	bool ok = false;
+	EngineCache::Engine tess = initTesseract(language, tesseract::OEM_DEFAULT, QString(), &ok);
+	if(!ok) {
+		tess = initTesseract(QString(), tesseract::OEM_DEFAULT, QString());
+	}
 	GenericVector<STRING> availLanguages;
 	tess->GetAvailableLanguagesAsVector(&availLanguages);
 	QStringList result;
@@ -130,22 +179,56 @@ QStringList Recognizer::getAvailableLanguages() const {
 	return result;
 }
 
-std::unique_ptr<tesseract::TessBaseAPI> Recognizer::initTesseract(const char* language, bool* ok) const {
-	// unfortunately tesseract creates deliberate aborts when an error occurs
-	std::signal(SIGABRT, MainWindow::tesseractCrash);
-	QByteArray current = setlocale(LC_ALL, NULL);
-	setlocale(LC_ALL, "C");
-	std::unique_ptr<tesseract::TessBaseAPI> tess(new tesseract::TessBaseAPI());
-	int ret = tess->Init(nullptr, language);
-	setlocale(LC_NUMERIC, current.constData());
+EngineCache::Engine Recognizer::initTesseract(const QString& language, int oem, const QString& datapath, bool* ok) const {
+	return m_engineCache.acquire(language, oem, datapath, ok);
+}
 
-	if(ok) {
-		*ok = ret != -1;
+const RecognitionProfile& Recognizer::getProfile() const {
+	const RecognitionProfile* profile = RecognitionProfile::find(ConfigSettings::get<VarSetting<QString>>("ocrprofile")->getValue());
+	return profile ? *profile : RecognitionProfile::get(RecognitionProfile::Id::Balanced);
+}
+
+Recognizer::EngineSettings Recognizer::getEngineSettings() const {
+	const RecognitionProfile& profile = getProfile();
+	EngineSettings settings;
+	settings.language = m_curLang.prefix;
+	settings.datapath = profile.modelPath(MAIN->getConfig()->tessdataLocation(), settings.language);
+	// Without its traineddata variant, the engine mode of the profile may not be supported by the installed traineddata
+	settings.oem = settings.datapath.isEmpty() && !profile.modelSet.isEmpty() ? int(tesseract::OEM_DEFAULT) : profile.oem;
+	settings.psm = m_psmCheckGroup->checkedAction()->data().toInt();
+	if(m_charListDialogUi.radioButtonWhitelist->isChecked()) {
+		settings.charWhitelist = m_charListDialogUi.lineEditWhitelist->text();
+	}
+	if(m_charListDialogUi.radioButtonBlacklist->isChecked()) {
+		settings.charBlacklist = m_charListDialogUi.lineEditBlacklist->text();
 	}
-	return std::move(tess);
+	// The confidences are only available in hOCR results
+	settings.retryConfidence = MAIN->getOutputEditor()->resultFormat() == OutputEditor::ResultFormat::HOCR ? MAIN->getConfig()->retryConfidence() : 0;
+	return settings;
+}
+
+QByteArray Recognizer::jobJournalKey(const QList<PageJob>& jobs, const EngineSettings& settings, bool autodetectLayout, bool prependFile, bool prependPage, bool skipBlank, bool skipDuplicates, bool routing) const {
+	// Any change to the pages, their rendering or the recognition settings makes it a different job
+	QStringList description = {
+		settings.language, QString::number(settings.oem), settings.datapath, QString::number(settings.psm), settings.charWhitelist, settings.charBlacklist,
+		QString::number(settings.retryConfidence), MAIN->getOutputEditor()->metaObject()->className(), QString::number(autodetectLayout), QString::number(prependFile), QString::number(prependPage),
+		QString::number(skipBlank), QString::number(skipDuplicates), QString::number(routing)
+	};
+	for(const PageJob& job : jobs) {
+		QStringList areas;
+		for(const QRectF& area : job.ocrAreas) {
+			areas.append(QString("%1,%2,%3,%4").arg(area.x()).arg(area.y()).arg(area.width()).arg(area.height()));
+		}
+		description.append(QString("%1:%2:%3:%4:%5:%6:%7:%8:%9:%10").arg(job.render.file).arg(QFileInfo(job.render.file).lastModified().toString(Qt::ISODate))
+		                   .arg(job.render.page).arg(job.render.resolution).arg(job.render.brightness).arg(job.render.contrast).arg(int(job.render.invert))
+		                   .arg(job.render.angle).arg(areas.join(";")).arg(int(job.deskew)));
+	}
+	return JobJournal::computeKey(description);
 }
 
 void Recognizer::updateLanguagesMenu() {
+	// The installed tessdata may have changed
+	m_engineCache.clear();
 	ui.menuLanguages->clear();
 	delete m_langMenuRadioGroup;
 	m_langMenuRadioGroup = new QActionGroup(this);
@@ -157,9 +240,9 @@ void Recognizer::updateLanguagesMenu() {
 	connect(m_psmCheckGroup, SIGNAL(triggered(QAction*)), this, SLOT(psmSelected(QAction*)));
 	m_menuMultilanguage = nullptr;
 	m_curLang = Config::Lang();
+	m_haveOsd = false;
 	QAction* curitem = nullptr;
 	QAction* activeitem = nullptr;
-	bool haveOsd = false;
 
 	QStringList parts = ConfigSettings::get<VarSetting<QString>>("language")->getValue().split(":");
 	Config::Lang curlang = {parts.empty() ? "eng" : parts[0], parts.size() < 2 ? "" : parts[1], parts.size() < 3 ? "" : parts[2]};
@@ -177,7 +260,7 @@ void Recognizer::updateLanguagesMenu() {
 	// Add menu items for languages, with spelling submenu if available
 	for(const QString& langprefix : availLanguages) {
 		if(langprefix == "osd") {
-			haveOsd = true;
+			m_haveOsd = true;
 			continue;
 		}
 		Config::Lang lang = {langprefix, QString(), QString()};
@@ -288,7 +371,7 @@ void Recognizer::updateLanguagesMenu() {
 	for(const auto& entry : psmModes) {
 		QAction* item = psmMenu->addAction(entry.label);
 		item->setData(entry.psmMode);
-		item->setEnabled(!entry.requireOsd || haveOsd);
+		item->setEnabled(!entry.requireOsd || m_haveOsd);
 		item->setCheckable(true);
 		item->setChecked(activePsm == entry.psmMode);
 		m_psmCheckGroup->addAction(item);
@@ -299,6 +382,24 @@ void Recognizer::updateLanguagesMenu() {
 	ui.menuLanguages->addAction(psmAction);
 	ui.menuLanguages->addAction(_("Character whitelist / blacklist..."), this, SLOT(manageCharacterLists()));
 
+	// Add profile items
+	delete m_profileGroup;
+	m_profileGroup = new QActionGroup(this);
+	connect(m_profileGroup, SIGNAL(triggered(QAction*)), this, SLOT(profileSelected(QAction*)));
+	QMenu* profileMenu = new QMenu();
+	const RecognitionProfile& activeProfile = getProfile();
+	for(const RecognitionProfile& profile : RecognitionProfile::profiles()) {
+		QAction* item = profileMenu->addAction(profile.label);
+		item->setData(profile.name);
+		item->setCheckable(true);
+		item->setChecked(profile.id == activeProfile.id);
+		m_profileGroup->addAction(item);
+	}
+	updateProfileLabels();
+	QAction* profileAction = new QAction(_("Recognition profile"), ui.menuLanguages);
+	profileAction->setMenu(profileMenu);
+	ui.menuLanguages->addAction(profileAction);
+
 
 	// Add installer item
 	ui.menuLanguages->addSeparator();
@@ -317,6 +418,7 @@ void Recognizer::setLanguage() {
 		ui.toolButtonRecognize->setText(QString("%1\n%2").arg(m_modeLabel).arg(m_langLabel));
 		m_curLang = lang;
 		ConfigSettings::get<VarSetting<QString>>("language")->setValue(lang.prefix + ":" + lang.code);
+		m_warmTimer.start(500);
 		emit languageChanged(m_curLang);
 	}
 }
@@ -337,9 +439,16 @@ void Recognizer::setMultiLanguage() {
 	ui.toolButtonRecognize->setText(QString("%1\n%2").arg(m_modeLabel).arg(m_langLabel));
 	m_curLang = {langs, "", "Multilingual"};
 	ConfigSettings::get<VarSetting<QString>>("language")->setValue(langs + ":");
+	m_warmTimer.start(500);
 	emit languageChanged(m_curLang);
 }
 
+void Recognizer::warmEngine() {
+	// Initialize an engine for the selected language in the background, so that the next recognition starts immediately
+	EngineSettings settings = getEngineSettings();
+	m_engineCache.warm(settings.language, settings.oem, settings.datapath);
+}
+
 void Recognizer::setRecognizeMode(const QString& mode) {
 	m_modeLabel = mode;
 	ui.toolButtonRecognize->setText(QString("%1\n%2").arg(m_modeLabel).arg(m_langLabel));
@@ -353,6 +462,26 @@ void Recognizer::psmSelected(QAction* action) {
 	ConfigSettings::get<VarSetting<int>>("psm")->setValue(action->data().toInt());
 }
 
+void Recognizer::profileSelected(QAction* action) {
+	ConfigSettings::get<VarSetting<QString>>("ocrprofile")->setValue(action->data().toString());
+	// Switch to the segmentation mode of the profile, it can still be changed afterwards
+	int psm = getProfile().psm;
+	for(QAction* item : m_psmCheckGroup->actions()) {
+		if(item->data().toInt() == psm && item->isEnabled()) {
+			item->setChecked(true);
+			ConfigSettings::get<VarSetting<int>>("psm")->setValue(psm);
+		}
+	}
+	m_warmTimer.start(500);
+}
+
+void Recognizer::updateProfileLabels() {
+	for(QAction* item : m_profileGroup->actions()) {
+		const RecognitionProfile* profile = RecognitionProfile::find(item->data().toString());
+		item->setText(profile->throughputLabel());
+	}
+}
+
 void Recognizer::manageCharacterLists() {
 	m_charListDialog->exec();
 }
@@ -431,66 +560,105 @@ void Recognizer::recognizeMultiplePages() {
 void Recognizer::recognize(const QList<int>& pages, bool autodetectLayout) {
 	bool prependFile = pages.size() > 1 && ConfigSettings::get<SwitchSetting>("ocraddsourcefilename")->getValue();
 	bool prependPage = pages.size() > 1 && ConfigSettings::get<SwitchSetting>("ocraddsourcepage")->getValue();
+	EngineSettings settings = getEngineSettings();
+	const RecognitionProfile& profile = getProfile();
+	ResultCache* resultCache = MAIN->getResultCache();
+	resultCache->setMaxSize(MAIN->getConfig()->resultCacheSize());
+	// The engine returns to the cache right away, where the pipeline acquires it again
 	bool ok = false;
-	auto tess = initTesseract(m_curLang.prefix.toLocal8Bit().constData(), &ok);
+	initTesseract(settings.language, settings.oem, settings.datapath, &ok);
 	if(ok) {
-		QString failed;
-		tess->SetPageSegMode(static_cast<tesseract::PageSegMode>(m_psmCheckGroup->checkedAction()->data().toInt()));
-		if(m_charListDialogUi.radioButtonWhitelist->isChecked()) {
-			tess->SetVariable("tessedit_char_whitelist", m_charListDialogUi.lineEditWhitelist->text().toLocal8Bit());
+		if(!profile.modelSet.isEmpty() && settings.datapath.isEmpty()) {
+			MainWindow::NotificationAction actionManage = {_("Manage languages"), MAIN, SLOT(manageLanguages()), true};
+			MAIN->addNotification(_("Traineddata missing"), _("The traineddata of the %1 profile are not installed for %2, the installed traineddata are used instead.").arg(profile.label).arg(settings.language), {actionManage});
 		}
-		if(m_charListDialogUi.radioButtonBlacklist->isChecked()) {
-			tess->SetVariable("tessedit_char_blacklist", m_charListDialogUi.lineEditBlacklist->text().toLocal8Bit());
+		// Take everything needed to render the pages up front, the pipeline then runs independently of the displayer
+		Displayer* displayer = MAIN->getDisplayer();
+		Displayer::RenderSettings current = displayer->getRenderSettings(displayer->getCurrentPage());
+		QList<QRectF> ocrAreas = autodetectLayout ? QList<QRectF>() : displayer->getOCRAreaRects();
+		RecognitionPipeline::Options options;
+		options.settings = settings;
+		options.autodetectLayout = autodetectLayout;
+		options.routing = m_haveOsd && MAIN->getConfig()->scriptRouting();
+		options.prependFile = prependFile;
+		options.prependPage = prependPage;
+		options.skipBlank = MAIN->getConfig()->skipBlankPages();
+		options.skipDuplicates = MAIN->getConfig()->skipDuplicatePages();
+		options.threads = MAIN->getConfig()->recognitionThreads();
+		// Worker processes isolate the application from tesseract aborts
+		options.processes = MAIN->getConfig()->recognitionProcesses();
+		// Bound the time spent on pathological pages
+		options.pageTimeout = MAIN->getConfig()->pageTimeout();
+		options.timeoutPolicy = MAIN->getConfig()->timeoutPolicy();
+		options.resultCache = resultCache;
+		options.performanceLog = MAIN->getPerformanceLog();
+		// Recognition areas are defined on the page as displayed, such pages are not deskewed
+		bool deskew = autodetectLayout || (ocrAreas.isEmpty() && MAIN->getConfig()->deskewPages());
+		QList<PageJob> jobs;
+		QString prevFile;
+		for(int page : pages) {
+			PageJob job;
+			job.render = displayer->getRenderSettings(page);
+			job.render.resolution = profile.resolution(job.render.file, job.render.resolution);
+			job.newFile = job.render.file != prevFile;
+			job.deskew = deskew;
+			prevFile = job.render.file;
+			job.timingId = options.performanceLog->addPage(job.render.file, job.render.page);
+			// The areas are defined on the current page, scale and rotate them as the displayer does when switching pages
+			double factor = double(job.render.resolution) / double(current.resolution);
+			QTransform rotation;
+			rotation.rotate(job.render.angle - current.angle);
+			for(const QRectF& area : ocrAreas) {
+				job.ocrAreas.append(QRectF(rotation.map(area.topLeft() * factor), rotation.map(area.bottomRight() * factor)).normalized());
+			}
+			jobs.append(job);
 		}
-		OutputEditor::ReadSessionData* readSessionData = MAIN->getOutputEditor()->initRead(*tess);
-		ProgressMonitor monitor(pages.size());
-		MAIN->showProgress(&monitor);
-		Utils::busyTask([&] {
-			int npages = pages.size();
-			int idx = 0;
-			QString prevFile;
-			for(int page : pages) {
-				monitor.desc.progress = 0;
-				++idx;
-				QMetaObject::invokeMethod(MAIN, "pushState", Qt::QueuedConnection, Q_ARG(MainWindow::State, MainWindow::State::Busy), Q_ARG(QString, _("Recognizing page %1 (%2 of %3)").arg(page).arg(idx).arg(npages)));
-
-				PageData pageData;
-				pageData.success = false;
-				QMetaObject::invokeMethod(this, "setPage", Qt::BlockingQueuedConnection, Q_RETURN_ARG(PageData, pageData), Q_ARG(int, page), Q_ARG(bool, autodetectLayout));
-				if(!pageData.success) {
-					failed.append(_("\n- Page %1: failed to render page").arg(page));
-					MAIN->getOutputEditor()->readError(_("\n[Failed to recognize page %1]\n"), readSessionData);
-					continue;
-				}
-				readSessionData->file = pageData.filename;
-				readSessionData->page = pageData.page;
-				readSessionData->angle = pageData.angle;
-				readSessionData->resolution = pageData.resolution;
-				bool firstChunk = true;
-				bool newFile = readSessionData->file != prevFile;
-				prevFile = readSessionData->file;
-				for(const QImage& image : pageData.ocrAreas) {
-					readSessionData->prependPage = prependPage && firstChunk;
-					readSessionData->prependFile = prependFile && (readSessionData->prependPage || newFile);
-					firstChunk = false;
-					newFile = false;
-					tess->SetImage(image.bits(), image.width(), image.height(), 4, image.bytesPerLine());
-					tess->SetSourceResolution(MAIN->getDisplayer()->getCurrentResolution());
-					tess->Recognize(&monitor.desc);
-					if(!monitor.cancelled()) {
-						MAIN->getOutputEditor()->read(*tess, readSessionData);
-					}
-				}
-				QMetaObject::invokeMethod(MAIN, "popState", Qt::QueuedConnection);
-				monitor.increaseProgress();
-				if(monitor.cancelled()) {
-					break;
+
+		// Multi-page jobs keep a journal of the completed pages, so that an interrupted job can be resumed
+		std::unique_ptr<JobJournal> journal;
+		if(pages.size() > 1) {
+			journal.reset(new JobJournal(jobJournalKey(jobs, settings, autodetectLayout, prependFile, prependPage, options.skipBlank, options.skipDuplicates, options.routing)));
+			if(journal->completedPages() > 0) {
+				QString message = _("A previous recognition of these pages was interrupted after %1 of %2 pages. Do you want to resume it and only recognize the remaining pages?").arg(journal->completedPages()).arg(pages.size());
+				if(QMessageBox::question(MAIN, _("Resume Recognition?"), message, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) != QMessageBox::Yes) {
+					journal->discard();
 				}
 			}
-			return true;
-		}, _("Recognizing..."));
-		MAIN->hideProgress();
-		MAIN->getOutputEditor()->finalizeRead(readSessionData);
+		}
+		options.journal = journal.get();
+
+		RecognitionPipeline::Outcome outcome;
+		QElapsedTimer jobTimer;
+		jobTimer.start();
+		bool cancelled = false;
+		{
+			EditorOutput output(MAIN->getOutputEditor(), pages);
+			RecognitionPipeline pipeline(jobs, options, m_engineCache, output);
+			MAIN->showProgress(pipeline.monitor());
+			Utils::busyTask([&] {
+				outcome = pipeline.run();
+				return true;
+			}, _("Recognizing..."));
+			MAIN->hideProgress();
+			cancelled = pipeline.monitor()->cancelled();
+		}
+		if(!cancelled) {
+			profile.addThroughput(outcome.recognizedPages, jobTimer.elapsed());
+			updateProfileLabels();
+		}
+		QString failed;
+		for(const QPair<int, QString>& failure : outcome.failures) {
+			failed.append(_("\n- Page %1: %2").arg(pages[failure.first]).arg(failure.second));
+		}
+		if(outcome.initFailed) {
+			failed.append(_("\n- Failed to initialize tesseract"));
+		}
+		if(journal && !cancelled && failed.isEmpty()) {
+			journal->discard();
+		}
+		if(!outcome.skipped.isEmpty()) {
+			MAIN->addNotification(_("Pages skipped"), _("%1 blank or duplicate pages were not recognized.").arg(outcome.skipped.size()), {});
+		}
 		if(!failed.isEmpty()) {
 			QMessageBox::critical(MAIN, _("Recognition errors occurred"), _("The following errors occurred:%1").arg(failed));
 		}
@@ -498,32 +666,69 @@ void Recognizer::recognize(const QList<int>& pages, bool autodetectLayout) {
 }
 
 bool Recognizer::recognizeImage(const QImage& image, OutputDestination dest) {
+	EngineSettings settings = getEngineSettings();
 	bool ok = false;
-	auto tess = initTesseract(m_curLang.prefix.toLocal8Bit().constData(), &ok);
+	EngineCache::Engine tess = initTesseract(settings.language, settings.oem, settings.datapath, &ok);
 	if(!ok) {
 		QMessageBox::critical(MAIN, _("Recognition errors occurred"), _("Failed to initialize tesseract"));
 		return false;
 	}
-	tess->SetImage(image.bits(), image.width(), image.height(), 4, image.bytesPerLine());
-	ProgressMonitor monitor(1);
+	RecognitionPipeline::applyEngineSettings(*tess, settings);
+	Utils::setOcrImage(*tess, image);
+	RecognitionPipeline::ProgressMonitor monitor(1);
 	MAIN->showProgress(&monitor);
 	if(dest == OutputDestination::Buffer) {
-		OutputEditor::ReadSessionData* readSessionData = MAIN->getOutputEditor()->initRead(*tess);
+		MAIN->getOutputEditor()->prepareEngine(*tess);
+		OutputEditor::ReadSessionData* readSessionData = MAIN->getOutputEditor()->initRead();
 		readSessionData->file = MAIN->getDisplayer()->getCurrentImage(readSessionData->page);
 		readSessionData->angle = MAIN->getDisplayer()->getCurrentAngle();
 		readSessionData->resolution = MAIN->getDisplayer()->getCurrentResolution();
-		Utils::busyTask([&] {
-			tess->Recognize(&monitor.desc);
-			if(!monitor.cancelled()) {
-				MAIN->getOutputEditor()->read(*tess, readSessionData);
-			}
-			return true;
-		}, _("Recognizing..."));
+		PerformanceLog* performanceLog = MAIN->getPerformanceLog();
+		readSessionData->timingId = performanceLog->addPage(readSessionData->file, readSessionData->page);
+		ResultCache* resultCache = MAIN->getResultCache();
+		resultCache->setMaxSize(MAIN->getConfig()->resultCacheSize());
+		QByteArray cacheKey;
+		QString result;
+		if(resultCache->enabled()) {
+			cacheKey = RecognitionPipeline::resultCacheKey(image, settings, MAIN->getOutputEditor()->metaObject()->className(), readSessionData->page, readSessionData->resolution);
+		}
+		if(!cacheKey.isEmpty() && resultCache->lookup(cacheKey, result)) {
+			MAIN->getOutputEditor()->readResult(result, readSessionData);
+		} else {
+			Utils::busyTask([&] {
+				PerformanceLog::Timer timer;
+				tess->Recognize(&monitor.desc());
+				performanceLog->addTime(readSessionData->timingId, PerformanceLog::StageRecognize, timer);
+				if(!monitor.cancelled()) {
+					timer.restart();
+					result = MAIN->getOutputEditor()->extractResult(*tess, readSessionData->page);
+					performanceLog->addTime(readSessionData->timingId, PerformanceLog::StageParse, timer);
+					if(settings.retryConfidence > 0) {
+						timer.restart();
+						result = ConfidenceRetry::improve(result, image, readSessionData->resolution, settings.retryConfidence, [&](const QImage& lineImage, int psm, int resolution) {
+							tess->SetPageSegMode(static_cast<tesseract::PageSegMode>(psm));
+							Utils::setOcrImage(*tess, lineImage);
+							tess->SetSourceResolution(resolution);
+							tess->Recognize(&monitor.desc());
+							return monitor.cancelled() ? QString() : MAIN->getOutputEditor()->extractResult(*tess, readSessionData->page);
+						});
+						performanceLog->addTime(readSessionData->timingId, PerformanceLog::StageRetry, timer);
+					}
+					MAIN->getOutputEditor()->readResult(result, readSessionData);
+					// A cancelled second pass leaves a partially improved result
+					if(!cacheKey.isEmpty() && !monitor.cancelled()) {
+						resultCache->insert(cacheKey, result);
+					}
+				}
+				return true;
+			}, _("Recognizing..."));
+			resultCache->sync();
+		}
 		MAIN->getOutputEditor()->finalizeRead(readSessionData);
 	} else if(dest == OutputDestination::Clipboard) {
 		QString output;
 		if(Utils::busyTask([&] {
-		tess->Recognize(&monitor.desc);
+		tess->Recognize(&monitor.desc());
 			if(!monitor.cancelled()) {
 				char* text = tess->GetUTF8Text();
 				output = QString::fromUtf8(text);
@@ -539,19 +744,32 @@ bool Recognizer::recognizeImage(const QImage& image, OutputDestination dest) {
 	return true;
 }
 
-Recognizer::PageData Recognizer::setPage(int page, bool autodetectLayout) {
-	PageData pageData;
-	pageData.success = MAIN->getDisplayer()->setup(&page);
-	if(pageData.success) {
-		if(autodetectLayout) {
-			MAIN->getDisplayer()->autodetectOCRAreas();
-		}
-		pageData.filename = MAIN->getDisplayer()->getCurrentImage(pageData.page);
-		pageData.angle = MAIN->getDisplayer()->getCurrentAngle();
-		pageData.resolution = MAIN->getDisplayer()->getCurrentResolution();
-		pageData.ocrAreas = MAIN->getDisplayer()->getOCRAreas();
+Recognizer::RegionStatus Recognizer::recognizeRegion(const QImage& image, int resolution, int psm, int page, QString& result) {
+	EngineSettings settings = getEngineSettings();
+	bool ok = false;
+	EngineCache::Engine tess = initTesseract(settings.language, settings.oem, settings.datapath, &ok);
+	if(!ok) {
+		return RegionStatus::InitFailed;
 	}
-	return pageData;
+	RecognitionPipeline::applyEngineSettings(*tess, settings);
+	OutputEditor::prepareEngine(*tess, OutputEditor::ResultFormat::HOCR);
+	tess->SetPageSegMode(static_cast<tesseract::PageSegMode>(psm));
+	QImage ocrImage = Utils::ocrImage(image);
+	Utils::setOcrImage(*tess, ocrImage);
+	tess->SetSourceResolution(resolution);
+	// The user waits for the result, running recognition jobs yield cores to it
+	CpuBudget::Interactive interactive;
+	RecognitionPipeline::ProgressMonitor monitor(1);
+	MAIN->showProgress(&monitor);
+	Utils::busyTask([&] {
+		tess->Recognize(&monitor.desc());
+		if(!monitor.cancelled()) {
+			result = OutputEditor::extractResult(*tess, OutputEditor::ResultFormat::HOCR, page);
+		}
+		return true;
+	}, _("Recognizing..."));
+	MAIN->hideProgress();
+	return monitor.cancelled() ? RegionStatus::Cancelled : RegionStatus::Recognized;
 }
 
 bool Recognizer::eventFilter(QObject* obj, QEvent* ev) {
@@ -20,23 +20,28 @@
 #ifndef RECOGNIZER_HPP
 #define RECOGNIZER_HPP
 
+#include <QTimer>
 #include <QToolButton>
-#include <memory>
 
 #include "Config.hh"
 #include "Displayer.hh"
+#include "EngineCache.hh"
+#include "OutputEditor.hh"
+#include "RecognitionPipeline.hh"
 #include "ui_PageRangeDialog.h"
 #include "ui_CharacterListDialog.h"
 
 namespace tesseract {
 class TessBaseAPI;
 }
+class RecognitionProfile;
 class UI_MainWindow;
 
 class Recognizer : public QObject {
 	Q_OBJECT
 public:
 	enum class OutputDestination { Buffer, Clipboard };
+	enum class RegionStatus { Recognized, Cancelled, InitFailed };
 
 	Recognizer(const UI_MainWindow& _ui);
 	QStringList getAvailableLanguages() const;
@@ -46,6 +51,9 @@ public:
 
 public slots:
 	bool recognizeImage(const QImage& image, OutputDestination dest);
+	// Recognizes a region of a page as hOCR with the given page segmentation mode, on a cached engine with the current
+	// settings, i.e. to correct a region in the hOCR editor. The result is only set if the region was recognized.
+	RegionStatus recognizeRegion(const QImage& image, int resolution, int psm, int page, QString& result);
 	void setRecognizeMode(const QString& mode);
 	void updateLanguagesMenu();
 
@@ -53,17 +61,11 @@ signals:
 	void languageChanged(const Config::Lang& lang);
 
 private:
-	struct ProgressMonitor;
+	class EditorOutput;
+	typedef RecognitionPipeline::EngineSettings EngineSettings;
+	typedef RecognitionPipeline::PageJob PageJob;
 	enum class PageSelection { Prompt, Current, Multiple };
 	enum class PageArea { EntirePage, Autodetect };
-	struct PageData {
-		bool success;
-		QString filename;
-		int page;
-		double angle;
-		int resolution;
-		QList<QImage> ocrAreas;
-	};
 
 	const UI_MainWindow& ui;
 	QMenu* m_menuPages = nullptr;
@@ -75,26 +77,35 @@ private:
 	QActionGroup* m_langMenuRadioGroup = nullptr;
 	QActionGroup* m_langMenuCheckGroup = nullptr;
 	QActionGroup* m_psmCheckGroup = nullptr;
+	QActionGroup* m_profileGroup = nullptr;
 	QAction* m_multilingualAction = nullptr;
 	QString m_modeLabel;
 	QString m_langLabel;
 	Config::Lang m_curLang;
+	mutable EngineCache m_engineCache;
+	bool m_haveOsd = false;
+	QTimer m_warmTimer;
 
-	std::unique_ptr<tesseract::TessBaseAPI> initTesseract(const char* language = nullptr, bool* ok = nullptr) const;
+	EngineCache::Engine initTesseract(const QString& language, int oem, const QString& datapath, bool* ok = nullptr) const;
+	const RecognitionProfile& getProfile() const;
+	EngineSettings getEngineSettings() const;
+	QByteArray jobJournalKey(const QList<PageJob>& jobs, const EngineSettings& settings, bool autodetectLayout, bool prependFile, bool prependPage, bool skipBlank, bool skipDuplicates, bool routing) const;
 	QList<int> selectPages(bool& autodetectLayout);
 	void recognize(const QList<int>& pages, bool autodetectLayout = false);
+	void updateProfileLabels();
 	bool eventFilter(QObject* obj, QEvent* ev) override;
 
 private slots:
 	void clearLineEditPageRangeStyle();
 	void manageCharacterLists();
+	void profileSelected(QAction* action);
 	void psmSelected(QAction* action);
 	void recognizeButtonClicked();
 	void recognizeCurrentPage();
 	void recognizeMultiplePages();
 	void setLanguage();
 	void setMultiLanguage();
-	PageData setPage(int page, bool autodetectLayout);
+	void warmEngine();
 };
 
 #endif // RECOGNIZER_HPP
@@ -0,0 +1,177 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * RenderCache.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "DisplayRenderer.hh"
+#include "RenderCache.hh"
+
+QByteArray RenderCache::rawKey(const QString& file, int page, double resolution) {
+	// The modification time invalidates the renders of a file which was overwritten, i.e. by a new scan
+	qint64 modified = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+	return QString("%1\n%2\n%3\n%4").arg(file).arg(modified).arg(page).arg(resolution, 0, 'g', 10).toUtf8();
+}
+
+QByteArray RenderCache::adjustedKey(const QString& file, int page, double resolution, int brightness, int contrast, bool invert) {
+	if(brightness == 0 && contrast == 0 && !invert) {
+		// Without adjustments the adjusted image is the raw one
+		return rawKey(file, page, resolution);
+	}
+	return rawKey(file, page, resolution) + QString("\n%1\n%2\n%3").arg(brightness).arg(contrast).arg(invert).toUtf8();
+}
+
+QByteArray RenderCache::regionKey(const QString& file, int page, double resolution, const QRect& region, int brightness, int contrast, bool invert) {
+	return adjustedKey(file, page, resolution, brightness, contrast, invert) + QString("\n%1,%2,%3,%4").arg(region.x()).arg(region.y()).arg(region.width()).arg(region.height()).toUtf8();
+}
+
+bool RenderCache::lookup(const QByteArray& key, QImage& image) {
+	QMutexLocker locker(&m_mutex);
+	if(m_maxSize <= 0) {
+		return false;
+	}
+	auto it = m_entries.find(key);
+	if(it == m_entries.end()) {
+		++m_misses;
+		return false;
+	}
+	m_lru.remove(it.value().lastUsed);
+	it.value().lastUsed = ++m_clock;
+	m_lru.insert(it.value().lastUsed, key);
+	// Implicitly shared, the caller detaches when modifying the image
+	image = it.value().image;
+	++m_hits;
+	return true;
+}
+
+bool RenderCache::contains(const QByteArray& key) const {
+	QMutexLocker locker(&m_mutex);
+	return m_entries.contains(key);
+}
+
+void RenderCache::insert(const QByteArray& key, const QImage& image) {
+	QMutexLocker locker(&m_mutex);
+	if(m_maxSize <= 0 || image.isNull() || imageSize(image) > m_maxSize) {
+		return;
+	}
+	remove(key);
+	Entry entry = {image, ++m_clock};
+	m_entries.insert(key, entry);
+	m_lru.insert(entry.lastUsed, key);
+	m_size += imageSize(image);
+	evict();
+}
+
+QImage RenderCache::render(const DisplayRenderer& renderer, int page, double resolution, int brightness, int contrast, bool invert) {
+	const QString& file = renderer.getFilename();
+	QByteArray key = adjustedKey(file, page, resolution, brightness, contrast, invert);
+	QImage image;
+	if(lookup(key, image)) {
+		return image;
+	}
+	QByteArray raw = rawKey(file, page, resolution);
+	if(raw == key || !lookup(raw, image)) {
+		image = renderer.render(page, resolution);
+		if(image.isNull()) {
+			return image;
+		}
+		insert(raw, image);
+	}
+	if(raw != key) {
+		// Detaches the image from the cached raw render
+		renderer.adjustImage(image, brightness, contrast, invert);
+		insert(key, image);
+	}
+	return image;
+}
+
+QImage RenderCache::renderRegion(const DisplayRenderer& renderer, int page, double resolution, const QRect& region, int brightness, int contrast, bool invert) {
+	QByteArray key = regionKey(renderer.getFilename(), page, resolution, region, brightness, contrast, invert);
+	QImage image;
+	if(lookup(key, image)) {
+		return image;
+	}
+	image = renderer.renderRegion(page, resolution, region);
+	if(image.isNull()) {
+		return image;
+	}
+	renderer.adjustImage(image, brightness, contrast, invert);
+	insert(key, image);
+	return image;
+}
+
+void RenderCache::clear() {
+	QMutexLocker locker(&m_mutex);
+	m_entries.clear();
+	m_lru.clear();
+	m_size = 0;
+	m_hits = 0;
+	m_misses = 0;
+}
+
+void RenderCache::setMaxSize(qint64 maxSize) {
+	QMutexLocker locker(&m_mutex);
+	m_maxSize = maxSize;
+	evict();
+}
+
+bool RenderCache::enabled() const {
+	QMutexLocker locker(&m_mutex);
+	return m_maxSize > 0;
+}
+
+qint64 RenderCache::maxSize() const {
+	QMutexLocker locker(&m_mutex);
+	return m_maxSize;
+}
+
+int RenderCache::hits() const {
+	QMutexLocker locker(&m_mutex);
+	return m_hits;
+}
+
+int RenderCache::misses() const {
+	QMutexLocker locker(&m_mutex);
+	return m_misses;
+}
+
+qint64 RenderCache::size() const {
+	QMutexLocker locker(&m_mutex);
+	return m_size;
+}
+
+void RenderCache::evict() {
+	// Called with m_mutex locked. Unlike the result cache, a disabled cache releases its memory.
+	while(m_size > m_maxSize && !m_lru.isEmpty()) {
+		QByteArray key = m_lru.first();
+		remove(key);
+	}
+}
+
+void RenderCache::remove(const QByteArray& key) {
+	// Called with m_mutex locked
+	auto it = m_entries.find(key);
+	if(it != m_entries.end()) {
+		m_lru.remove(it.value().lastUsed);
+		m_size -= imageSize(it.value().image);
+		m_entries.erase(it);
+	}
+}
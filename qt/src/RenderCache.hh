@@ -0,0 +1,84 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * RenderCache.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RENDERCACHE_HH
+#define RENDERCACHE_HH
+
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QRect>
+#include <QString>
+
+class DisplayRenderer;
+
+// In-memory cache of rendered page images. The raw renders of the sources are
+// keyed by file, page and resolution, the adjusted images derived from them
+// additionally by the brightness, contrast and invert settings. The least
+// recently used images are evicted once the memory budget is exceeded.
+class RenderCache {
+public:
+	static QByteArray rawKey(const QString& file, int page, double resolution);
+	static QByteArray adjustedKey(const QString& file, int page, double resolution, int brightness, int contrast, bool invert);
+	static QByteArray regionKey(const QString& file, int page, double resolution, const QRect& region, int brightness, int contrast, bool invert);
+
+	bool lookup(const QByteArray& key, QImage& image);
+	// Unlike lookup, neither counts as hit or miss nor marks the image as used
+	bool contains(const QByteArray& key) const;
+	void insert(const QByteArray& key, const QImage& image);
+	// Renders and adjusts a page, reusing and caching the raw render and the adjusted image
+	QImage render(const DisplayRenderer& renderer, int page, double resolution, int brightness, int contrast, bool invert);
+	// Renders and adjusts a region of a page, only the adjusted region is cached
+	QImage renderRegion(const DisplayRenderer& renderer, int page, double resolution, const QRect& region, int brightness, int contrast, bool invert);
+	void clear();
+	// A maximum size of zero disables the cache
+	void setMaxSize(qint64 maxSize);
+	bool enabled() const;
+	qint64 maxSize() const;
+
+	int hits() const;
+	int misses() const;
+	qint64 size() const;
+
+private:
+	struct Entry {
+		QImage image;
+		quint64 lastUsed;
+	};
+
+	mutable QMutex m_mutex;
+	QHash<QByteArray, Entry> m_entries;
+	QMap<quint64, QByteArray> m_lru; // lastUsed -> key
+	quint64 m_clock = 0;
+	qint64 m_size = 0;
+	qint64 m_maxSize = 0;
+	int m_hits = 0;
+	int m_misses = 0;
+
+	static qint64 imageSize(const QImage& image) {
+		return qint64(image.bytesPerLine()) * image.height();
+	}
+	void evict();
+	void remove(const QByteArray& key);
+};
+
+#endif // RENDERCACHE_HH
@@ -0,0 +1,197 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * ResultCache.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QImage>
+#include <QTextStream>
+#include <algorithm>
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+#include <QDesktopServices>
+#else
+#include <QStandardPaths>
+#endif
+
+#include "ResultCache.hh"
+
+ResultCache::ResultCache() {
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+	QString cacheDir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#else
+	QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#endif
+	m_dir = QDir(QDir(cacheDir).absoluteFilePath("results"));
+
+	// Index lines are "<key> <size> <lastUsed>", entries without result file are dropped
+	QFile index(m_dir.absoluteFilePath("index"));
+	if(index.open(QIODevice::ReadOnly)) {
+		QTextStream stream(&index);
+		while(!stream.atEnd()) {
+			QStringList fields = stream.readLine().split(' ');
+			if(fields.size() != 3 || !m_dir.exists(fields[0])) {
+				continue;
+			}
+			QByteArray key = fields[0].toLatin1();
+			Entry entry = {fields[1].toLongLong(), fields[2].toULongLong()};
+			m_entries.insert(key, entry);
+			m_lru.insert(entry.lastUsed, key);
+			m_size += entry.size;
+			m_clock = std::max(m_clock, entry.lastUsed);
+		}
+	}
+}
+
+ResultCache::~ResultCache() {
+	sync();
+}
+
+QByteArray ResultCache::computeKey(const QImage& image, const QByteArray& settings) {
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(settings);
+	hash.addData(QString("%1x%2:%3").arg(image.width()).arg(image.height()).arg(image.format()).toLatin1());
+	// Only hash the pixels, not the scanline padding
+	int lineBytes = (image.width() * image.depth() + 7) / 8;
+	for(int y = 0, n = image.height(); y < n; ++y) {
+		hash.addData(reinterpret_cast<const char*>(image.constScanLine(y)), lineBytes);
+	}
+	return hash.result().toHex();
+}
+
+bool ResultCache::lookup(const QByteArray& key, QString& result) {
+	QMutexLocker locker(&m_mutex);
+	if(m_maxSize <= 0) {
+		return false;
+	}
+	auto it = m_entries.find(key);
+	if(it == m_entries.end()) {
+		++m_misses;
+		return false;
+	}
+	QFile file(m_dir.absoluteFilePath(key));
+	if(!file.open(QIODevice::ReadOnly)) {
+		remove(key);
+		++m_misses;
+		return false;
+	}
+	result = QString::fromUtf8(file.readAll());
+	touch(key, it.value());
+	++m_hits;
+	return true;
+}
+
+void ResultCache::insert(const QByteArray& key, const QString& result) {
+	QMutexLocker locker(&m_mutex);
+	if(m_maxSize <= 0 || !m_dir.mkpath(".")) {
+		return;
+	}
+	QByteArray data = result.toUtf8();
+	QFile file(m_dir.absoluteFilePath(key));
+	if(!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+		file.remove();
+		return;
+	}
+	remove(key);
+	Entry entry = {data.size(), 0};
+	touch(key, entry);
+	m_entries.insert(key, entry);
+	m_size += entry.size;
+	evict();
+}
+
+void ResultCache::sync() {
+	QMutexLocker locker(&m_mutex);
+	if(!m_dirty || !m_dir.mkpath(".")) {
+		return;
+	}
+	QFile index(m_dir.absoluteFilePath("index"));
+	if(index.open(QIODevice::WriteOnly)) {
+		QTextStream stream(&index);
+		for(auto it = m_entries.begin(), itEnd = m_entries.end(); it != itEnd; ++it) {
+			stream << it.key() << " " << it.value().size << " " << it.value().lastUsed << "\n";
+		}
+		m_dirty = false;
+	}
+}
+
+void ResultCache::clear() {
+	QMutexLocker locker(&m_mutex);
+	for(const QByteArray& key : m_entries.keys()) {
+		m_dir.remove(key);
+	}
+	m_entries.clear();
+	m_lru.clear();
+	m_size = 0;
+	m_hits = 0;
+	m_misses = 0;
+	m_dirty = true;
+}
+
+void ResultCache::setMaxSize(qint64 maxSize) {
+	QMutexLocker locker(&m_mutex);
+	m_maxSize = maxSize;
+	evict();
+}
+
+bool ResultCache::enabled() const {
+	QMutexLocker locker(&m_mutex);
+	return m_maxSize > 0;
+}
+
+int ResultCache::hits() const {
+	QMutexLocker locker(&m_mutex);
+	return m_hits;
+}
+
+int ResultCache::misses() const {
+	QMutexLocker locker(&m_mutex);
+	return m_misses;
+}
+
+qint64 ResultCache::size() const {
+	QMutexLocker locker(&m_mutex);
+	return m_size;
+}
+
+void ResultCache::touch(const QByteArray& key, Entry& entry) {
+	// Called with m_mutex locked
+	m_lru.remove(entry.lastUsed);
+	entry.lastUsed = ++m_clock;
+	m_lru.insert(entry.lastUsed, key);
+	m_dirty = true;
+}
+
+void ResultCache::evict() {
+	// Called with m_mutex locked. A disabled cache keeps its entries for when it is enabled again.
+	while(m_maxSize > 0 && m_size > m_maxSize && !m_lru.isEmpty()) {
+		QByteArray key = m_lru.first();
+		m_dir.remove(key);
+		remove(key);
+	}
+}
+
+void ResultCache::remove(const QByteArray& key) {
+	// Called with m_mutex locked
+	auto it = m_entries.find(key);
+	if(it != m_entries.end()) {
+		m_lru.remove(it.value().lastUsed);
+		m_size -= it.value().size;
+		m_entries.erase(it);
+		m_dirty = true;
+	}
+}
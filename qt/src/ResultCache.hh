@@ -0,0 +1,77 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * ResultCache.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESULTCACHE_HH
+#define RESULTCACHE_HH
+
+#include <QByteArray>
+#include <QDir>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+class QImage;
+
+// Persistent cache of recognition results, keyed by a hash of the recognized
+// pixels and of all settings which affect the result. The least recently used
+// entries are evicted once the configured size is exceeded.
+class ResultCache {
+public:
+	ResultCache();
+	~ResultCache();
+
+	static QByteArray computeKey(const QImage& image, const QByteArray& settings);
+
+	bool lookup(const QByteArray& key, QString& result);
+	void insert(const QByteArray& key, const QString& result);
+	// Writes the index to disk
+	void sync();
+	void clear();
+	// A maximum size of zero disables the cache
+	void setMaxSize(qint64 maxSize);
+	bool enabled() const;
+
+	int hits() const;
+	int misses() const;
+	qint64 size() const;
+
+private:
+	struct Entry {
+		qint64 size;
+		quint64 lastUsed;
+	};
+
+	mutable QMutex m_mutex;
+	QDir m_dir;
+	QHash<QByteArray, Entry> m_entries;
+	QMap<quint64, QByteArray> m_lru; // lastUsed -> key
+	quint64 m_clock = 0;
+	qint64 m_size = 0;
+	qint64 m_maxSize = 0;
+	int m_hits = 0;
+	int m_misses = 0;
+	bool m_dirty = false;
+
+	void touch(const QByteArray& key, Entry& entry);
+	void evict();
+	void remove(const QByteArray& key);
+};
+
+#endif // RESULTCACHE_HH
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * ScriptRouter.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QImage>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
+
+#include "EngineCache.hh"
+#include "LangTables.hh"
+#include "ScriptRouter.hh"
+#include "Utils.hh"
+
+const QMultiMap<QString, QString> ScriptRouter::LANGUAGE_SCRIPTS = LangTables::languageScripts<QMultiMap<QString, QString>>();
+
+// Script detections with a lower confidence are not conclusive, i.e. for blocks with little text
+static const float MIN_SCRIPT_CONFIDENCE = 1.f;
+
+ScriptRouter::ScriptRouter(const QString& language) : m_language(language) {
+	for(const QString& prefix : language.split('+', QString::SkipEmptyParts)) {
+		for(const QString& script : languageScripts(prefix)) {
+			m_scriptLanguages[script].append(prefix);
+		}
+	}
+}
+
+QStringList ScriptRouter::languageScripts(const QString& prefix) {
+	// Script traineddata are named after their script, i.e. script/Cyrillic or, up to tesseract 4.0.0-beta.1, Cyrillic
+	if(prefix.startsWith("script/")) {
+		return QStringList() << prefix.mid(7);
+	} else if(prefix.left(1) == prefix.left(1).toUpper()) {
+		return QStringList() << prefix;
+	}
+	QStringList scripts = LANGUAGE_SCRIPTS.values(prefix);
+	return scripts.isEmpty() ? QStringList() << "Latin" : scripts;
+}
+
+bool ScriptRouter::enabled() const {
+#if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 0, 0)
+	// Languages written in several scripts, i.e. jpn in Japanese and Han, map each of them to the same languages
+	QStringList selection = m_language.split('+', QString::SkipEmptyParts);
+	selection.removeDuplicates();
+	selection.sort();
+	QList<QStringList> subsets;
+	for(QStringList languages : m_scriptLanguages) {
+		languages.removeDuplicates();
+		languages.sort();
+		if(languages != selection && !subsets.contains(languages)) {
+			subsets.append(languages);
+		}
+	}
+	return subsets.size() > 1;
+#else
+	return false;
+#endif
+}
+
+QStringList ScriptRouter::routes() const {
+	QStringList routes;
+	for(const QStringList& languages : m_scriptLanguages) {
+		QString route = languages.join("+");
+		if(!routes.contains(route)) {
+			routes.append(route);
+		}
+	}
+	routes.append(m_language);
+	return routes;
+}
+
+QString ScriptRouter::route(EngineCache& engineCache, const QImage& image, int resolution) const {
+#if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 0, 0)
+	bool ok = false;
+	EngineCache::Engine osd = engineCache.acquire("osd", tesseract::OEM_DEFAULT, QString(), &ok);
+	if(!ok) {
+		return m_language;
+	}
+	Utils::setOcrImage(*osd, image);
+	osd->SetSourceResolution(resolution);
+	int orientation = 0;
+	float orientationConfidence = 0.f;
+	const char* script = nullptr;
+	float scriptConfidence = 0.f;
+	if(osd->DetectOrientationScript(&orientation, &orientationConfidence, &script, &scriptConfidence) && script && scriptConfidence >= MIN_SCRIPT_CONFIDENCE) {
+		auto it = m_scriptLanguages.find(QString::fromLatin1(script));
+		if(it != m_scriptLanguages.end()) {
+			return it.value().join("+");
+		}
+	}
+#else
+	Q_UNUSED(engineCache);
+	Q_UNUSED(image);
+	Q_UNUSED(resolution);
+#endif
+	return m_language;
+}
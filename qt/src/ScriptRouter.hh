@@ -0,0 +1,56 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * ScriptRouter.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SCRIPTROUTER_HH
+#define SCRIPTROUTER_HH
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+class EngineCache;
+class QImage;
+
+// Routes the text blocks of multilingual pages to engines which only load the
+// selected languages of the script a block is written in, instead of evaluating
+// every selected language on every line. The script is determined by tesseract's
+// orientation and script detection, which requires the osd traineddata.
+class ScriptRouter {
+public:
+	// language is the '+' separated selection of languages
+	ScriptRouter(const QString& language);
+
+	// Routing only pays off if at least two scripts are routed to different subsets of the selected languages
+	bool enabled() const;
+	// The distinct languages route can return
+	QStringList routes() const;
+	// Returns the selected languages written in the script of the image, or the entire selection if the script cannot be determined
+	QString route(EngineCache& engineCache, const QImage& image, int resolution) const;
+
+private:
+	QString m_language;
+	QMap<QString, QStringList> m_scriptLanguages; // Selected languages by script
+
+	static const QMultiMap<QString, QString> LANGUAGE_SCRIPTS;
+
+	static QStringList languageScripts(const QString& prefix);
+};
+
+#endif // SCRIPTROUTER_HH
@@ -28,6 +28,7 @@
 #include <QImageReader>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QString>
 #include <QTemporaryFile>
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
@@ -37,6 +38,7 @@
 #endif
 
 #include "ConfigSettings.hh"
+#include "DocumentCache.hh"
 #include "FileDialogs.hh"
 #include "MainWindow.hh"
 #include "SourceManager.hh"
@@ -135,7 +137,13 @@ int SourceManager::addSources(const QStringList& files, bool suppressTextWarning
 }
 
 bool SourceManager::checkPdfSource(Source* source, QStringList& filesWithText) const {
-	std::unique_ptr<Poppler::Document> document(Poppler::Document::load(source->path));
+	// The document is shared with the renderers of the displayer, which open the file next
+	std::shared_ptr<DocumentCache::PdfHandle> pdf = DocumentCache::instance().pdf(source->path);
+	if(!pdf->document) {
+		return false;
+	}
+	QMutexLocker locker(&pdf->mutex);
+	Poppler::Document* document = pdf->document;
 
 	// Unlock if necessary
 	if(document->isLocked()) {
@@ -143,7 +151,10 @@ bool SourceManager::checkPdfSource(Source* source, QStringList& filesWithText) c
 		QString message = QString(_("Enter password for file '%1':")).arg(QFileInfo(source->path).fileName());
 		QString text;
 		while(true) {
+			// Not locked while the dialog runs the event loop, which may render from the document
+			locker.unlock();
 			text = QInputDialog::getText(MAIN, _("Protected PDF"), message, QLineEdit::Password, text, &ok);
+			locker.relock();
 			if(!ok) {
 				return false;
 			}
@@ -17,6 +17,7 @@
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QComboBox>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QDialogButtonBox>
@@ -40,6 +41,7 @@
 
 #include "ConfigSettings.hh"
 #include "MainWindow.hh"
+#include "RecognitionProfile.hh"
 #include "Recognizer.hh"
 #include "TessdataManager.hh"
 #include "Utils.hh"
@@ -50,6 +52,17 @@ TessdataManager::TessdataManager(QWidget* parent)
 	setLayout(new QVBoxLayout());
 	layout()->addWidget(new QLabel(_("Manage installed languages:")));
 
+	// The traineddata variants of the recognition profiles are installed next to the standard traineddata
+	m_modelSetCombo = new QComboBox(this);
+	m_modelSetCombo->addItem(_("Standard traineddata"), QString());
+	for(const RecognitionProfile& profile : RecognitionProfile::profiles()) {
+		if(!profile.modelSet.isEmpty()) {
+			m_modelSetCombo->addItem(_("%1 profile (%2)").arg(profile.label).arg(profile.repository), profile.name);
+		}
+	}
+	m_modelSetCombo->setVisible(m_modelSetCombo->count() > 1);
+	layout()->addWidget(m_modelSetCombo);
+
 	m_languageList = new QListWidget(this);
 	layout()->addWidget(m_languageList);
 
@@ -61,6 +74,7 @@ TessdataManager::TessdataManager(QWidget* parent)
 	connect(bbox, SIGNAL(accepted()), this, SLOT(accept()));
 	connect(bbox, SIGNAL(rejected()), this, SLOT(reject()));
 	connect(refreshButton, SIGNAL(clicked(bool)), this, SLOT(refresh()));
+	connect(m_modelSetCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(modelSetChanged()));
 	layout()->addWidget(bbox);
 	setFixedWidth(320);
 }
@@ -74,6 +88,8 @@ bool TessdataManager::setup() {
 			QMessageBox::critical(MAIN, _("Error"), _("A session connection to the PackageKit backend is required for managing system-wide tesseract language packs, but it was not found. This service is usually provided by a software-management application such as Gnome Software. Please install software which provides the necessary PackageKit interface, use other system package management software to manage the tesseract language packs directly, or switch to using the user tessdata path in the configuration dialog."));
 			return false;
 		}
+		// PackageKit only provides the standard traineddata
+		m_modelSetCombo->setEnabled(false);
 	}
 #endif
 	MAIN->pushState(MainWindow::State::Busy, _("Fetching available languages"));
@@ -87,15 +103,44 @@ bool TessdataManager::setup() {
 	return true;
 }
 
+const RecognitionProfile* TessdataManager::selectedProfile() const {
+	return RecognitionProfile::find(m_modelSetCombo->itemData(m_modelSetCombo->currentIndex()).toString());
+}
+
+QStringList TessdataManager::availableLanguages() const {
+	const RecognitionProfile* profile = selectedProfile();
+	if(profile) {
+		return profile->installedLanguages(MAIN->getConfig()->tessdataLocation());
+	}
+	return MAIN->getRecognizer()->getAvailableLanguages();
+}
+
+void TessdataManager::modelSetChanged() {
+	MAIN->pushState(MainWindow::State::Busy, _("Fetching available languages"));
+	QString messages;
+	bool success = fetchLanguageList(messages);
+	MAIN->popState();
+	if(!success) {
+		QMessageBox::critical(this, _("Error"), _("Failed to fetch list of available languages: %1").arg(messages));
+	}
+}
+
 bool TessdataManager::fetchLanguageList(QString& messages) {
 	m_languageList->clear();
+	m_languageFiles.clear();
 
-	// Get newest tag older or equal to used tesseract version
 #if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 0, 0)
-	QUrl url("https://api.github.com/repos/tesseract-ocr/tessdata_fast/tags");
+	QString repository = "tessdata_fast";
 #else
-	QUrl url("https://api.github.com/repos/tesseract-ocr/tessdata/tags");
+	QString repository = "tessdata";
 #endif
+	const RecognitionProfile* profile = selectedProfile();
+	if(profile) {
+		repository = profile->repository;
+	}
+
+	// Get newest tag older or equal to used tesseract version
+	QUrl url(QString("https://api.github.com/repos/tesseract-ocr/%1/tags").arg(repository));
 	QByteArray data = Utils::download(url, messages);
 	if(data.isEmpty()) {
 		messages = _("Failed to fetch list of available languages: %1").arg(messages);
@@ -137,12 +182,9 @@ bool TessdataManager::fetchLanguageList(QString& messages) {
 
 	QVector<QPair<QString, QString>> extraFiles;
 	QList<QUrl> dataUrls;
+	dataUrls.append(QUrl(QString("https://api.github.com/repos/tesseract-ocr/%1/contents?ref=%2").arg(repository).arg(tessdataVer)));
 #if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 0, 0)
-	dataUrls.append(QUrl("https://api.github.com/repos/tesseract-ocr/tessdata_fast/contents?ref=" + tessdataVer));
-	dataUrls.append(QUrl("https://api.github.com/repos/tesseract-ocr/tessdata_fast/contents/script?ref=" + tessdataVer));
-#else
-
-	dataUrls.append(QUrl("https://api.github.com/repos/tesseract-ocr/tessdata/contents?ref=" + tessdataVer));
+	dataUrls.append(QUrl(QString("https://api.github.com/repos/tesseract-ocr/%1/contents/script?ref=%2").arg(repository).arg(tessdataVer)));
 #endif
 	for(const QUrl& url : dataUrls) {
 		data = Utils::download(url, messages);
@@ -198,7 +240,7 @@ bool TessdataManager::fetchLanguageList(QString& messages) {
 		return false;
 	}
 
-	QStringList availableLanguages = MAIN->getRecognizer()->getAvailableLanguages();
+	QStringList availableLanguages = this->availableLanguages();
 
 	QStringList languages = QStringList(m_languageFiles.keys());
 	qSort(languages.begin(), languages.end(), [](const QString & s1, const QString & s2) {
@@ -232,14 +274,18 @@ void TessdataManager::applyChanges() {
 	MAIN->pushState(MainWindow::State::Busy, _("Applying changes..."));
 	setEnabled(false);
 	QString errorMsg;
-	QStringList availableLanguages = MAIN->getRecognizer()->getAvailableLanguages();
+	QStringList availableLanguages = this->availableLanguages();
 	QDir tessDataDir(MAIN->getConfig()->tessdataLocation());
+	const RecognitionProfile* profile = selectedProfile();
+	if(profile) {
+		tessDataDir = QDir(tessDataDir.absoluteFilePath(profile->modelSet));
+	}
 #ifdef Q_OS_WIN
 	bool isWindows = true;
 #else
 	bool isWindows = false;
 #endif
-	if(!isWindows && MAIN->getConfig()->useSystemDataLocations()) {
+	if(!isWindows && MAIN->getConfig()->useSystemDataLocations() && !profile) {
 		// Place this in a ifdef since DBus stuff cannot be compiled on Windows
 #ifdef Q_OS_LINUX
 		QStringList installFiles;
@@ -318,7 +364,7 @@ void TessdataManager::applyChanges() {
 
 void TessdataManager::refresh() {
 	MAIN->getRecognizer()->updateLanguagesMenu();
-	QStringList availableLanguages = MAIN->getRecognizer()->getAvailableLanguages();
+	QStringList availableLanguages = this->availableLanguages();
 	for(int row = 0, nRows = m_languageList->count(); row < nRows; ++row) {
 		QListWidgetItem* item = m_languageList->item(row);
 		QString prefix = item->data(Qt::UserRole).toString();
@@ -23,7 +23,9 @@
 #include <QDialog>
 #include <QMap>
 
+class QComboBox;
 class QListWidget;
+class RecognitionProfile;
 
 class TessdataManager : public QDialog {
 	Q_OBJECT
@@ -37,13 +39,18 @@ private:
 		QString url;
 	};
 
+	QComboBox* m_modelSetCombo;
 	QListWidget* m_languageList;
 	QMap<QString, QList<LangFile>> m_languageFiles;
 
+	// Profile whose traineddata variant is managed, or nullptr for the installed traineddata
+	const RecognitionProfile* selectedProfile() const;
+	QStringList availableLanguages() const;
 	bool fetchLanguageList(QString& messages);
 
 private slots:
 	void applyChanges();
+	void modelSetChanged();
 	void refresh();
 };
 
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * TiledPageItem.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QMutexLocker>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "CpuBudget.hh"
+#include "DisplayRenderer.hh"
+#include "TiledPageItem.hh"
+
+// Edge length of the tiles in pixels of their level
+static const int TILE_SIZE = 512;
+// Memory of the rendered tiles, several times the tiles covering a large screen
+static const qint64 TILE_CACHE_SIZE = 64 * 1024 * 1024;
+// Tiles exposed earlier are dropped from the queue beyond this, they were most likely scrolled out of view
+static const int MAX_QUEUED_TILES = 64;
+
+TiledPageItem::TiledPageItem(QGraphicsItem* parent)
+	: QGraphicsObject(parent), m_thread(std::bind(&TiledPageItem::run, this)) {
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+	setAcceptedMouseButtons(Qt::NoButton);
+	m_tiles.setMaxSize(TILE_CACHE_SIZE);
+	m_thread.start();
+}
+
+TiledPageItem::~TiledPageItem() {
+	m_mutex.lock();
+	m_queue.clear();
+	m_quit = true;
+	m_cond.wakeAll();
+	m_mutex.unlock();
+	m_thread.wait();
+}
+
+void TiledPageItem::setPage(const Displayer::RenderSettings& settings, const QSize& size, double previewScale) {
+	prepareGeometryChange();
+	QMutexLocker locker(&m_mutex);
+	m_settings = settings;
+	m_size = size;
+	m_previewScale = previewScale;
+	m_queue.clear();
+	m_queued.clear();
+	++m_generation;
+	locker.unlock();
+	update();
+}
+
+QRectF TiledPageItem::boundingRect() const {
+	return QRectF(QPointF(0, 0), QSizeF(m_size));
+}
+
+QRect TiledPageItem::tileRegion(const Tile& tile) const {
+	double scale = std::ldexp(1., -tile.level);
+	QRect level(0, 0, std::ceil(m_size.width() * scale), std::ceil(m_size.height() * scale));
+	return QRect(tile.x * TILE_SIZE, tile.y * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(level);
+}
+
+void TiledPageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* /*widget*/) {
+	double lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+	if(lod <= m_previewScale || m_size.isEmpty()) {
+		// The preview underneath is detailed enough
+		return;
+	}
+	// The coarsest level which is at least as detailed as the view
+	Tile tile = {std::max(0, int(std::floor(std::log2(1. / lod)))), 0, 0};
+	double scale = std::ldexp(1., -tile.level);
+	QRectF exposed = option->exposedRect.intersected(boundingRect());
+	int x0 = std::floor(exposed.left() * scale / TILE_SIZE);
+	int x1 = std::ceil(exposed.right() * scale / TILE_SIZE);
+	int y0 = std::floor(exposed.top() * scale / TILE_SIZE);
+	int y1 = std::ceil(exposed.bottom() * scale / TILE_SIZE);
+	painter->setClipRect(boundingRect(), Qt::IntersectClip);
+	painter->setRenderHint(QPainter::SmoothPixmapTransform);
+
+	QMutexLocker locker(&m_mutex);
+	if(!m_queue.isEmpty() && m_queue.last().level != tile.level) {
+		// The view was zoomed, tiles of the previous level are no longer needed
+		m_queue.clear();
+		m_queued.clear();
+	}
+	bool queued = false;
+	for(tile.y = y0; tile.y < y1; ++tile.y) {
+		for(tile.x = x0; tile.x < x1; ++tile.x) {
+			QRect region = tileRegion(tile);
+			if(region.isEmpty()) {
+				continue;
+			}
+			QImage image;
+			QByteArray key = RenderCache::regionKey(m_settings.file, m_settings.page, m_settings.resolution * scale, region, m_settings.brightness, m_settings.contrast, m_settings.invert);
+			if(m_tiles.lookup(key, image)) {
+				painter->drawImage(QRectF(region.x() / scale, region.y() / scale, region.width() / scale, region.height() / scale), image);
+			} else if(!m_queued.contains(tileId(tile))) {
+				m_queue.append(tile);
+				m_queued.insert(tileId(tile));
+				queued = true;
+			}
+		}
+	}
+	while(m_queue.size() > MAX_QUEUED_TILES) {
+		m_queued.remove(tileId(m_queue.takeFirst()));
+	}
+	if(queued) {
+		m_cond.wakeOne();
+	}
+}
+
+void TiledPageItem::run() {
+	CpuBudget::setThreadShare(1);
+	// The renderer is kept while the pages are of the same file, i.e. to load a PDF only once
+	std::unique_ptr<DisplayRenderer> renderer;
+	QMutexLocker locker(&m_mutex);
+	while(true) {
+		while(m_queue.isEmpty() && !m_quit) {
+			m_cond.wait(&m_mutex);
+		}
+		if(m_quit) {
+			break;
+		}
+		// The most recently exposed tile first
+		Tile tile = m_queue.takeLast();
+		Displayer::RenderSettings settings = m_settings;
+		QRect region = tileRegion(tile);
+		int generation = m_generation;
+		locker.unlock();
+		if(!renderer || renderer->getFilename() != settings.file) {
+			renderer.reset(DisplayRenderer::create(settings.file, settings.password));
+		}
+		double scale = std::ldexp(1., -tile.level);
+		QImage image;
+		{
+			CpuBudget::Interactive interactive;
+			image = m_tiles.renderRegion(*renderer, settings.page, settings.resolution * scale, region, settings.brightness, settings.contrast, settings.invert);
+		}
+		if(!image.isNull()) {
+			QRectF rect(region.x() / scale, region.y() / scale, region.width() / scale, region.height() / scale);
+			QMetaObject::invokeMethod(this, "tileRendered", Qt::QueuedConnection, Q_ARG(int, generation), Q_ARG(QRectF, rect));
+		}
+		locker.relock();
+		m_queued.remove(tileId(tile));
+	}
+}
+
+void TiledPageItem::tileRendered(int generation, const QRectF& rect) {
+	// Tiles of a previous page are only cached
+	if(generation == m_generation) {
+		update(rect);
+	}
+}
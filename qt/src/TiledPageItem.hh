@@ -0,0 +1,90 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * TiledPageItem.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TILEDPAGEITEM_HH
+#define TILEDPAGEITEM_HH
+
+#include <QGraphicsObject>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
+
+#include "Displayer.hh"
+#include "RenderCache.hh"
+
+// Draws a page which is too large to be displayed as one pixmap from tiles of the visible area. The tiles
+// are taken from a pyramid of resolutions halving per level, at the coarsest level which still matches the
+// zoom of the view, and are rendered on a background thread into a bounded tile cache. The item has the
+// size of the page at its resolution and is drawn over a preview of the page, which shows until the tiles
+// are rendered and suffices for views zoomed out to the resolution of the preview.
+class TiledPageItem : public QGraphicsObject {
+	Q_OBJECT
+public:
+	TiledPageItem(QGraphicsItem* parent = nullptr);
+	~TiledPageItem();
+
+	// Replaces the page, the tiles still to be rendered for the previous page are discarded
+	void setPage(const Displayer::RenderSettings& settings, const QSize& size, double previewScale);
+	QRectF boundingRect() const override;
+	void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+	struct Tile {
+		int level;
+		int x;
+		int y;
+	};
+	class Thread : public QThread {
+	public:
+		Thread(const std::function<void()>& f) : m_f(f) {}
+	private:
+		std::function<void()> m_f;
+		void run() override {
+			m_f();
+		}
+	};
+
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+	QList<Tile> m_queue;
+	QSet<quint64> m_queued;
+	Displayer::RenderSettings m_settings;
+	QSize m_size;
+	double m_previewScale = 1.;
+	int m_generation = 0;
+	bool m_quit = false;
+	RenderCache m_tiles;
+	Thread m_thread;
+
+	static quint64 tileId(const Tile& tile) {
+		return (quint64(tile.level) << 48) | (quint64(tile.x) << 24) | quint64(tile.y);
+	}
+	// The area of the tile in pixels of its level
+	QRect tileRegion(const Tile& tile) const;
+	void run();
+
+private slots:
+	void tileRendered(int generation, const QRectF& rect);
+};
+
+#endif // TILEDPAGEITEM_HH
@@ -14,6 +14,7 @@ public:
 	QAction* actionPreferences;
 	QAction* actionRedetectLanguages;
 	QAction* actionManageLanguages;
+	QAction* actionPerformance;
 	QAction* actionRotateCurrentPage;
 	QAction* actionRotateAllPages;
 	QAction* actionSourceClear;
@@ -170,6 +171,9 @@ public:
 		actionManageLanguages = new QAction(QIcon::fromTheme("applications-education-language"), gettext("Manage Languages"), MainWindow);
 		menuAppMenu->addAction(actionManageLanguages);
 
+		actionPerformance = new QAction(QIcon::fromTheme("utilities-system-monitor"), gettext("Performance Statistics"), MainWindow);
+		menuAppMenu->addAction(actionPerformance);
+
 		actionPreferences = new QAction(QIcon::fromTheme("preferences-system"), gettext("Preferences"), MainWindow);
 		menuAppMenu->addAction(actionPreferences);
 
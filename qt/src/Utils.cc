@@ -32,6 +32,9 @@
 #include <QSslConfiguration>
 #include <QTimer>
 #include <QUrl>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
 
 #include "Utils.hh"
 #include "Config.hh"
@@ -218,3 +221,47 @@ QString Utils::getSpellingLanguage(const QString& lang) {
 	}
 	return syslang;
 }
+
+QString Utils::jsonString(const QString& str) {
+	QString escaped;
+	for(const QChar& c : str) {
+		if(c == '"' || c == '\\') {
+			escaped += QString("\\") + c;
+		} else if(c.unicode() < 0x20) {
+			escaped += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+		} else {
+			escaped += c;
+		}
+	}
+	return QString("\"%1\"").arg(escaped);
+}
+
+QImage Utils::ocrImage(const QImage& image) {
+	if(image.format() == QImage::Format_Mono || image.format() == QImage::Format_MonoLSB) {
+		QImage mono = image.convertToFormat(QImage::Format_Mono);
+		if(qGray(mono.color(1)) < qGray(mono.color(0))) {
+			// Swap the bits and the color table, the image looks the same but 1 is white
+			mono.invertPixels();
+			mono.setColorTable(QVector<QRgb>() << mono.color(1) << mono.color(0));
+		}
+		return mono;
+	}
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+	if(image.format() == QImage::Format_Grayscale8) {
+		return image;
+	}
+	// Checks the color table of indexed images, all pixels of others
+	if(image.allGray()) {
+		return image.convertToFormat(QImage::Format_Grayscale8);
+	}
+#endif
+	return image.convertToFormat(QImage::Format_RGB32);
+}
+
+int Utils::ocrBytesPerPixel(const QImage& image) {
+	return image.depth() == 1 ? 0 : image.depth() / 8;
+}
+
+void Utils::setOcrImage(tesseract::TessBaseAPI& tess, const QImage& image) {
+	tess.SetImage(image.constBits(), image.width(), image.height(), ocrBytesPerPixel(image), image.bytesPerLine());
+}
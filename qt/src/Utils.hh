@@ -26,6 +26,10 @@
 #include <QString>
 #include <QWaitCondition>
 
+namespace tesseract {
+class TessBaseAPI;
+}
+class QImage;
 class QMimeData;
 class QSpinBox;
 class QDoubleSpinBox;
@@ -53,6 +57,17 @@ QByteArray download(QUrl url, QString& messages, int timeout = 60000);
 
 QString getSpellingLanguage(const QString& lang = QString());
 
+// Quotes and escapes a string for use in JSON output
+QString jsonString(const QString& str);
+
+// Converts the image to the most compact format which tesseract reads without conversion:
+// 1 bit with 1 denoting white, 8 bit grayscale or 32 bit RGB
+QImage ocrImage(const QImage& image);
+// Bytes per pixel of an image in one of the above formats, as passed to tesseract (zero for 1 bit)
+int ocrBytesPerPixel(const QImage& image);
+// Sets an image in one of the above formats as the image to recognize. It must outlive the recognition.
+void setOcrImage(tesseract::TessBaseAPI& tess, const QImage& image);
+
 template<typename T>
 class AsyncQueue {
 public:
@@ -0,0 +1,283 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * WorkerProcess.cc
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QPair>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QSharedMemory>
+#include <cstdio>
+#include <cstring>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#include <tesseract/ocrclass.h>
+#undef USE_STD_NAMESPACE
+
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "Config.hh"
+#include "CpuBudget.hh"
+#include "EngineCache.hh"
+#include "Utils.hh"
+#include "WorkerProcess.hh"
+
+// Additional time granted to a worker to return from a timed out recognition before it is killed
+static const int WATCHDOG_GRACE_MSECS = 5000;
+
+// Messages are a 32 bit length followed by a QDataStream serialized payload
+static bool readFully(QIODevice& device, char* data, qint64 size) {
+	while(size > 0) {
+		qint64 n = device.read(data, size);
+		if(n <= 0) {
+			return false;
+		}
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+WorkerProcess::~WorkerProcess() {
+	stop();
+	delete m_memory;
+}
+
+WorkerProcess::Status WorkerProcess::recognize(const Request& request, const QImage& image, ETEXT_DESC& desc, QString& result) {
+	int imageSize = image.bytesPerLine() * image.height();
+	if((!m_process && !start()) || !prepareMemory(sizeof(SharedHeader) + imageSize)) {
+		return Status::Failed;
+	}
+	SharedHeader* header = static_cast<SharedHeader*>(m_memory->data());
+	header->progress = 0;
+	header->cancel = 0;
+	std::memcpy(header + 1, image.constBits(), imageSize);
+
+	QByteArray message;
+	QDataStream out(&message, QIODevice::WriteOnly);
+	out << m_memory->key() << request.language << qint32(request.oem) << request.datapath << qint32(request.psm) << request.charWhitelist << request.charBlacklist
+	    << qint32(request.format) << qint32(request.page) << qint32(request.resolution) << request.forcePsm << qint32(request.timeout)
+	    << qint32(image.width()) << qint32(image.height()) << qint32(image.bytesPerLine()) << qint32(Utils::ocrBytesPerPixel(image));
+	if(!writeMessage(*m_process, message)) {
+		stop();
+		return Status::Crashed;
+	}
+
+	QByteArray response;
+	QElapsedTimer timer;
+	timer.start();
+	while(!takeMessage(m_buffer, response)) {
+		if(m_process->state() == QProcess::NotRunning) {
+			stop();
+			return Status::Crashed;
+		}
+		if(request.timeout > 0 && timer.elapsed() > request.timeout + WATCHDOG_GRACE_MSECS) {
+			m_process->kill();
+			stop();
+			return Status::TimedOut;
+		}
+		m_process->waitForReadyRead(100);
+		m_buffer += m_process->readAllStandardOutput();
+		desc.progress = header->progress;
+		if(desc.cancel && desc.cancel(desc.cancel_this, 0)) {
+			header->cancel = 1;
+		}
+	}
+	QDataStream in(response);
+	qint32 status;
+	in >> status >> result;
+	return static_cast<Status>(status);
+}
+
+bool WorkerProcess::isWorkerCommand(int argc, char* argv[]) {
+	return argc >= 2 && std::strcmp("ocrworker", argv[1]) == 0;
+}
+
+int WorkerProcess::serve() {
+#ifdef Q_OS_WIN
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	QFile input;
+	QFile output;
+	if(!input.open(stdin, QIODevice::ReadOnly) || !output.open(stdout, QIODevice::WriteOnly)) {
+		return 1;
+	}
+	Config::initTessdataLocation();
+	EngineCache engineCache;
+	QSharedMemory memory;
+
+	while(true) {
+		quint32 size;
+		QByteArray message;
+		if(!readFully(input, reinterpret_cast<char*>(&size), sizeof(size))) {
+			// The application closed the pipe
+			break;
+		}
+		message.resize(size);
+		if(!readFully(input, message.data(), size)) {
+			break;
+		}
+		QDataStream in(message);
+		QString key;
+		Request request;
+		qint32 oem, psm, format, page, resolution, timeout, width, height, bytesPerLine, bytesPerPixel;
+		bool forcePsm;
+		in >> key >> request.language >> oem >> request.datapath >> psm >> request.charWhitelist >> request.charBlacklist >> format >> page >> resolution >> forcePsm >> timeout >> width >> height >> bytesPerLine >> bytesPerPixel;
+
+		Status status = Status::Failed;
+		QString result;
+		if(memory.key() != key) {
+			memory.detach();
+			memory.setKey(key);
+			memory.attach();
+		}
+		bool ok = false;
+		EngineCache::Engine tess = engineCache.acquire(request.language, oem, request.datapath, &ok);
+		if(memory.isAttached() && ok) {
+			SharedHeader* header = static_cast<SharedHeader*>(memory.data());
+			tess->SetPageSegMode(static_cast<tesseract::PageSegMode>(psm));
+			tess->SetVariable("tessedit_char_whitelist", request.charWhitelist.toLocal8Bit());
+			tess->SetVariable("tessedit_char_blacklist", request.charBlacklist.toLocal8Bit());
+			OutputEditor::prepareEngine(*tess, static_cast<OutputEditor::ResultFormat>(format));
+			if(forcePsm) {
+				tess->SetPageSegMode(static_cast<tesseract::PageSegMode>(psm));
+			}
+			tess->SetImage(reinterpret_cast<const unsigned char*>(header + 1), width, height, bytesPerPixel, bytesPerLine);
+			tess->SetSourceResolution(resolution);
+			ETEXT_DESC desc;
+			desc.progress = 0;
+			desc.cancel = cancelCallback;
+			QPair<ETEXT_DESC*, SharedHeader*> progress(&desc, header);
+			desc.cancel_this = &progress;
+			if(timeout > 0) {
+				desc.set_deadline_msecs(timeout);
+			}
+			tess->Recognize(&desc);
+			if(header->cancel) {
+				status = Status::Cancelled;
+			} else if(timeout > 0 && desc.deadline_exceeded()) {
+				status = Status::TimedOut;
+			} else {
+				result = OutputEditor::extractResult(*tess, static_cast<OutputEditor::ResultFormat>(format), page);
+				status = Status::Ok;
+			}
+			tess->Clear();
+		}
+
+		QByteArray response;
+		QDataStream out(&response, QIODevice::WriteOnly);
+		out << qint32(status) << result;
+		if(!writeMessage(output, response)) {
+			break;
+		}
+	}
+	return 0;
+}
+
+bool WorkerProcess::start() {
+	m_process = new QProcess();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+	// Standard output carries the results, but keep tesseract's diagnostics
+	m_process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+#endif
+	// Bound the OpenMP threads of tesseract in the worker to the share of the calling thread, unless the user did
+	QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+	if(!env.contains("OMP_THREAD_LIMIT")) {
+		env.insert("OMP_THREAD_LIMIT", QString::number(CpuBudget::threadShare()));
+	}
+	m_process->setProcessEnvironment(env);
+	m_process->start(QApplication::applicationFilePath(), QStringList() << "ocrworker");
+	if(!m_process->waitForStarted()) {
+		stop();
+		return false;
+	}
+	return true;
+}
+
+void WorkerProcess::stop() {
+	if(m_process) {
+		// Closing the input ends the request loop of an intact worker
+		m_process->closeWriteChannel();
+		if(!m_process->waitForFinished(1000)) {
+			m_process->kill();
+			m_process->waitForFinished();
+		}
+		delete m_process;
+		m_process = nullptr;
+	}
+	m_buffer.clear();
+}
+
+bool WorkerProcess::prepareMemory(int size) {
+	if(m_memory && m_memory->size() >= size) {
+		return true;
+	}
+	// The worker attaches to the segment by key, a new segment gets a new key
+	delete m_memory;
+	m_memory = new QSharedMemory(QString("%1-ocrworker-%2-%3").arg(PACKAGE_NAME).arg(QApplication::applicationPid()).arg(reinterpret_cast<quintptr>(this), 0, 16) + QString("-%1").arg(++m_memoryCount));
+	if(!m_memory->create(size)) {
+		delete m_memory;
+		m_memory = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool WorkerProcess::writeMessage(QIODevice& device, const QByteArray& message) {
+	quint32 size = message.size();
+	if(device.write(reinterpret_cast<const char*>(&size), sizeof(size)) != sizeof(size) || device.write(message) != message.size()) {
+		return false;
+	}
+	if(QFile* file = qobject_cast<QFile*>(&device)) {
+		return file->flush();
+	}
+	while(device.bytesToWrite() > 0) {
+		if(!device.waitForBytesWritten(-1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool WorkerProcess::takeMessage(QByteArray& buffer, QByteArray& message) {
+	quint32 size;
+	if(buffer.size() < int(sizeof(size))) {
+		return false;
+	}
+	std::memcpy(&size, buffer.constData(), sizeof(size));
+	if(buffer.size() < int(sizeof(size) + size)) {
+		return false;
+	}
+	message = buffer.mid(sizeof(size), size);
+	buffer.remove(0, sizeof(size) + size);
+	return true;
+}
+
+bool WorkerProcess::cancelCallback(void* instance, int /*words*/) {
+	QPair<ETEXT_DESC*, SharedHeader*>* progress = static_cast<QPair<ETEXT_DESC*, SharedHeader*>*>(instance);
+	progress->second->progress = progress->first->progress;
+	return progress->second->cancel != 0;
+}
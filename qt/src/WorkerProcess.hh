@@ -0,0 +1,87 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * WorkerProcess.hh
+ * Copyright (C) 2013-2019 Sandro Mani <manisandro@gmail.com>
+ *
+ * gImageReader is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gImageReader is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPROCESS_HH
+#define WORKERPROCESS_HH
+
+#include <QByteArray>
+#include <QString>
+
+#include "OutputEditor.hh"
+
+class ETEXT_DESC;
+class QImage;
+class QIODevice;
+class QProcess;
+class QSharedMemory;
+
+// Recognizes images in a child process, so that a tesseract abort only terminates
+// the worker. The pixels are passed through shared memory, the requests and
+// results through the standard input and output of the child process.
+class WorkerProcess {
+public:
+	struct Request {
+		QString language;
+		int oem;
+		QString datapath; // Empty for the configured tessdata location
+		int psm;
+		QString charWhitelist;
+		QString charBlacklist;
+		OutputEditor::ResultFormat format;
+		int page;
+		int resolution;
+		bool forcePsm; // Use psm even if the result format requires another mode
+		int timeout; // In milliseconds, zero for none
+	};
+	enum class Status { Ok, Cancelled, TimedOut, Failed, Crashed };
+
+	WorkerProcess() = default;
+	~WorkerProcess();
+
+	// Recognizes an image in one of the formats of Utils::ocrImage. Progress is reported to and cancellation polled from desc.
+	// If the child process crashed, a new one is started on the next call. A child which
+	// does not honour the timeout, i.e. because it is stuck in layout analysis, is killed.
+	Status recognize(const Request& request, const QImage& image, ETEXT_DESC& desc, QString& result);
+
+	static bool isWorkerCommand(int argc, char* argv[]);
+	// Request loop of the child process
+	static int serve();
+
+private:
+	// Precedes the pixels in the shared memory
+	struct SharedHeader {
+		volatile qint32 progress;
+		volatile qint32 cancel;
+	};
+
+	QProcess* m_process = nullptr;
+	QSharedMemory* m_memory = nullptr;
+	QByteArray m_buffer;
+	int m_memoryCount = 0;
+
+	bool start();
+	void stop();
+	bool prepareMemory(int size);
+
+	static bool writeMessage(QIODevice& device, const QByteArray& message);
+	static bool takeMessage(QByteArray& buffer, QByteArray& message);
+	static bool cancelCallback(void* instance, int words);
+};
+
+#endif // WORKERPROCESS_HH
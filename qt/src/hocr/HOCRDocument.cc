@@ -25,6 +25,9 @@
 #include <QTextStream>
 #include <QtSpell.hpp>
 #include <cmath>
+#define USE_STD_NAMESPACE
+#include <tesseract/baseapi.h>
+#undef USE_STD_NAMESPACE
 
 #include "common.hh"
 #include "HOCRDocument.hh"
@@ -69,6 +72,16 @@ QModelIndex HOCRDocument::addPage(const QDomElement& pageElement, bool cleanGrap
 	return index(newRow, 0);
 }
 
+QModelIndex HOCRDocument::addPage(HOCRPage* page) {
+	int newRow = m_pages.size();
+	page->adopt(++m_pageIdCounter, m_defaultLanguage, newRow);
+	beginInsertRows(QModelIndex(), newRow, newRow);
+	m_pages.append(page);
+	endInsertRows();
+	emit dataChanged(index(0, 0), index(m_pages.size() - 1, 0), {Qt::DisplayRole});
+	return index(newRow, 0);
+}
+
 bool HOCRDocument::editItemAttribute(const QModelIndex& index, const QString& name, const QString& value, const QString& attrItemClass) {
 	HOCRItem* item = mutableItemAtIndex(index);
 	if(!item) {
@@ -228,6 +241,87 @@ QModelIndex HOCRDocument::addItem(const QModelIndex& parent, const QDomElement&
 	return index(pos, 0, parent);
 }
 
+static QString wordLanguage(const HOCRItem* item) {
+	if(item->itemClass() == "ocrx_word") {
+		return item->lang();
+	}
+	for(const HOCRItem* child : item->children()) {
+		QString lang = wordLanguage(child);
+		if(!lang.isEmpty()) {
+			return lang;
+		}
+	}
+	return QString();
+}
+
+QList<HOCRItem*> HOCRDocument::parseItems(HOCRItem* parentItem, const QList<QDomElement>& elements, const QString& language) const {
+	// Same children and languages as for a parsed page. Items without words are dropped, a region has no graphics to keep.
+	QList<HOCRItem*> items;
+	for(const QDomElement& element : elements) {
+		HOCRItem* item = new HOCRItem(element, parentItem->page(), parentItem);
+		if(item->parseChildren(element, language)) {
+			items.append(item);
+		} else {
+			delete item;
+		}
+	}
+	return items;
+}
+
+bool HOCRDocument::replaceChildren(const QModelIndex& parent, const QList<QDomElement>& elements) {
+	HOCRItem* parentItem = mutableItemAtIndex(parent);
+	if(!parentItem) {
+		return false;
+	}
+	// Words without a language of their own inherit the one of the replaced words, or of the page for a new item
+	QString language = wordLanguage(parentItem);
+	if(language.isEmpty()) {
+		language = wordLanguage(parentItem->page());
+	}
+	QList<HOCRItem*> items = parseItems(parentItem, elements, language.isEmpty() ? m_defaultLanguage : language);
+	if(items.isEmpty()) {
+		return false;
+	}
+	int nChildren = parentItem->children().size();
+	if(nChildren > 0) {
+		beginRemoveRows(parent, 0, nChildren - 1);
+		qDeleteAll(parentItem->takeChildren());
+		endRemoveRows();
+	}
+	beginInsertRows(parent, 0, items.size() - 1);
+	for(HOCRItem* item : items) {
+		parentItem->addChild(item);
+	}
+	recomputeBBoxes(parentItem);
+	endInsertRows();
+	return true;
+}
+
+QModelIndex HOCRDocument::replaceItem(const QModelIndex& itemIndex, const QList<QDomElement>& elements) {
+	HOCRItem* item = mutableItemAtIndex(itemIndex);
+	if(!item || !item->parent()) {
+		return QModelIndex();
+	}
+	HOCRItem* parentItem = item->parent();
+	QString language = wordLanguage(item);
+	QList<HOCRItem*> items = parseItems(parentItem, elements, language.isEmpty() ? m_defaultLanguage : language);
+	if(items.isEmpty()) {
+		return QModelIndex();
+	}
+	QModelIndex parent = itemIndex.parent();
+	int row = itemIndex.row();
+	beginRemoveRows(parent, row, row);
+	deleteItem(item);
+	endRemoveRows();
+	beginInsertRows(parent, row, row + items.size() - 1);
+	for(int i = 0, n = items.size(); i < n; ++i) {
+		parentItem->insertChild(items[i], row + i);
+	}
+	recomputeBBoxes(parentItem);
+	endInsertRows();
+	return index(row, 0, parent);
+}
+
 bool HOCRDocument::removeItem(const QModelIndex& index) {
 	HOCRItem* item = mutableItemAtIndex(index);
 	if(!item) {
@@ -666,6 +760,19 @@ QString HOCRItem::serializeAttrGroup(const QMap<QString, QString>& attrs) {
 	return list.join("; ");
 }
 
+void HOCRItem::mapBBoxes(QDomElement element, const QPoint& offset, double scale) {
+	QMap<QString, QString> attrs = deserializeAttrGroup(element.attribute("title"));
+	QStringList bbox = attrs["bbox"].split(QRegExp("\\s+"), QString::SkipEmptyParts);
+	if(bbox.size() == 4) {
+		attrs["bbox"] = QString("%1 %2 %3 %4").arg(qRound(bbox[0].toInt() * scale) + offset.x()).arg(qRound(bbox[1].toInt() * scale) + offset.y())
+		                .arg(qRound(bbox[2].toInt() * scale) + offset.x()).arg(qRound(bbox[3].toInt() * scale) + offset.y());
+		element.setAttribute("title", serializeAttrGroup(attrs));
+	}
+	for(QDomElement child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+		mapBBoxes(child, offset, scale);
+	}
+}
+
 QString HOCRItem::trimmedWord(const QString& word, QString* prefix, QString* suffix) {
 	// correctly trim words with apostrophes or hyphens within them, phrases with dashes, initialisms/acronyms, and numeric citations
 	QRegExp wordRe("^(\\W*)(\\w?|\\w(\\w|[-\\x2013\\x2014'’])*\\w|(\\w+\\.){2,})([\\W\\x00b2\\x00b3\\x00b9\\x2070-\\x207e]*)$");
@@ -718,10 +825,23 @@ HOCRItem::HOCRItem(const QDomElement& element, HOCRPage* page, HOCRItem* parent,
 	}
 }
 
+HOCRItem::HOCRItem(const QString& itemClass, HOCRPage* page, HOCRItem* parent)
+	: m_pageItem(page), m_parentItem(parent), m_index(parent ? parent->m_childItems.size() : -1) {
+	m_attrs["class"] = itemClass;
+	if(parent) {
+		parent->m_childItems.append(this);
+	}
+}
+
 HOCRItem::~HOCRItem() {
 	qDeleteAll(m_childItems);
 }
 
+void HOCRItem::setBBox(int x0, int y0, int x1, int y1) {
+	m_bbox.setCoords(x0, y0, x1, y1);
+	m_titleAttrs["bbox"] = QString("%1 %2 %3 %4").arg(x0).arg(y0).arg(x1).arg(y1);
+}
+
 void HOCRItem::addChild(HOCRItem* child) {
 	m_childItems.append(child);
 	child->m_parentItem = this;
@@ -903,12 +1023,8 @@ bool HOCRItem::parseChildren(const QDomElement& element, QString language) {
 	// Determine item language (inherit from parent if not specified)
 	QString elemLang = element.attribute("lang");
 	if(!elemLang.isEmpty()) {
-		auto it = s_langCache.find(elemLang);
-		if(it == s_langCache.end()) {
-			it = s_langCache.insert(elemLang, Utils::getSpellingLanguage(elemLang));
-		}
 		m_attrs.remove("lang");
-		language = it.value();
+		language = spellingLanguage(elemLang);
 	}
 
 	if(itemClass() == "ocrx_word") {
@@ -925,6 +1041,14 @@ bool HOCRItem::parseChildren(const QDomElement& element, QString language) {
 	return haveWords;
 }
 
+QString HOCRItem::spellingLanguage(const QString& lang) {
+	auto it = s_langCache.find(lang);
+	if(it == s_langCache.end()) {
+		it = s_langCache.insert(lang, Utils::getSpellingLanguage(lang));
+	}
+	return it.value();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 HOCRPage::HOCRPage(const QDomElement& element, int pageId, const QString& language, bool cleanGraphics, int index)
@@ -961,6 +1085,140 @@ HOCRPage::HOCRPage(const QDomElement& element, int pageId, const QString& langua
 	}
 }
 
+static bool containsWords(const HOCRItem* item) {
+	if(item->itemClass() == "ocrx_word") {
+		return !item->text().isEmpty();
+	}
+	for(const HOCRItem* child : item->children()) {
+		if(containsWords(child)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+HOCRPage::HOCRPage(tesseract::TessBaseAPI& tess, int pageNr, const QSize& size)
+	: HOCRItem("ocr_page", this, nullptr), m_pageId(0), m_pageNr(pageNr), m_angle(0.), m_resolution(0) {
+	setBBox(0, 0, size.width(), size.height());
+	m_titleAttrs["ppageno"] = QString::number(pageNr);
+
+	// Yields the same items and title attributes as parsing the output of GetHOCRText
+	tesseract::ResultIterator* it = tess.GetIterator();
+	if(!it) {
+		return;
+	}
+	bool fontInfo = false;
+	tess.GetBoolVariable("hocr_font_info", &fontInfo);
+	HOCRItem* block = nullptr;
+	HOCRItem* par = nullptr;
+	HOCRItem* line = nullptr;
+	bool parLtr = true;
+	int x0, y0, x1, y1;
+	for(; !it->Empty(tesseract::RIL_BLOCK); it->Next(tesseract::RIL_WORD)) {
+		if(it->Empty(tesseract::RIL_WORD)) {
+			// Like GetHOCRText, skip blocks without words, i.e. images
+			continue;
+		}
+		if(it->IsAtBeginningOf(tesseract::RIL_BLOCK)) {
+			block = new HOCRItem("ocr_carea", this, this);
+			it->BoundingBox(tesseract::RIL_BLOCK, &x0, &y0, &x1, &y1);
+			block->setBBox(x0, y0, x1, y1);
+		}
+		if(it->IsAtBeginningOf(tesseract::RIL_PARA)) {
+			par = new HOCRItem("ocr_par", this, block);
+			it->BoundingBox(tesseract::RIL_PARA, &x0, &y0, &x1, &y1);
+			par->setBBox(x0, y0, x1, y1);
+			parLtr = it->ParagraphIsLtr();
+			if(!parLtr) {
+				par->m_attrs["dir"] = "rtl";
+			}
+		}
+		if(it->IsAtBeginningOf(tesseract::RIL_TEXTLINE)) {
+			QString lineClass = "ocr_line";
+#if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 1, 0)
+			switch(it->BlockType()) {
+			case PT_HEADING_TEXT:
+				lineClass = "ocr_header";
+				break;
+			case PT_PULLOUT_TEXT:
+				lineClass = "ocr_textfloat";
+				break;
+			case PT_CAPTION_TEXT:
+				lineClass = "ocr_caption";
+				break;
+			default:
+				break;
+			}
+#endif
+			line = new HOCRItem(lineClass, this, par);
+			it->BoundingBox(tesseract::RIL_TEXTLINE, &x0, &y0, &x1, &y1);
+			line->setBBox(x0, y0, x1, y1);
+			tesseract::Orientation orientation;
+			tesseract::WritingDirection direction;
+			tesseract::TextlineOrder order;
+			float deskewAngle;
+			it->Orientation(&orientation, &direction, &order, &deskewAngle);
+			int bx0, by0, bx1, by1;
+			if(orientation != tesseract::ORIENTATION_PAGE_UP) {
+				line->m_titleAttrs["textangle"] = QString::number(360 - orientation * 90);
+			} else if(it->Baseline(tesseract::RIL_TEXTLINE, &bx0, &by0, &bx1, &by1) && bx0 != bx1) {
+				// Slope and offset relative to the bottom left corner of the line
+				double slope = double(by1 - by0) / (bx1 - bx0);
+				double offset = (by0 - y1) - slope * (bx0 - x0);
+				line->m_titleAttrs["baseline"] = QString("%1 %2").arg(std::round(slope * 1000.) / 1000.).arg(std::round(offset * 1000.) / 1000.);
+			}
+#if TESSERACT_VERSION >= TESSERACT_MAKE_VERSION(4, 0, 0)
+			float rowHeight, descenders, ascenders;
+			it->RowAttributes(&rowHeight, &descenders, &ascenders);
+			line->m_titleAttrs["x_size"] = QString::number(rowHeight);
+			line->m_titleAttrs["x_descenders"] = QString::number(-descenders);
+			line->m_titleAttrs["x_ascenders"] = QString::number(ascenders);
+#endif
+		}
+
+		HOCRItem* word = new HOCRItem("ocrx_word", this, line);
+		it->BoundingBox(tesseract::RIL_WORD, &x0, &y0, &x1, &y1);
+		word->setBBox(x0, y0, x1, y1);
+		word->m_titleAttrs["x_wconf"] = QString::number(int(it->Confidence(tesseract::RIL_WORD)));
+		bool bold = false, italic = false, underlined, monospace, serif, smallcaps;
+		int pointSize, fontId;
+		const char* fontName = it->WordFontAttributes(&bold, &italic, &underlined, &monospace, &serif, &smallcaps, &pointSize, &fontId);
+		if(fontInfo && fontName) {
+			word->m_titleAttrs["x_font"] = QString::fromUtf8(fontName);
+			word->m_titleAttrs["x_fsize"] = QString::number(pointSize);
+		}
+		word->m_bold = bold;
+		word->m_italic = italic;
+		tesseract::StrongScriptDirection wordDirection = it->WordDirection();
+		if(wordDirection == tesseract::DIR_LEFT_TO_RIGHT && !parLtr) {
+			word->m_attrs["dir"] = "ltr";
+		} else if(wordDirection == tesseract::DIR_RIGHT_TO_LEFT && parLtr) {
+			word->m_attrs["dir"] = "rtl";
+		}
+		// The recognition language, which is mapped to the spelling language in adopt
+		word->m_attrs["lang"] = QString::fromUtf8(it->WordRecognitionLanguage());
+		char* text = it->GetUTF8Text(tesseract::RIL_WORD);
+		word->m_text = QString::fromUtf8(text);
+		delete[] text;
+	}
+	delete it;
+
+	// Blocks whose words are all empty are graphics, as when parsing the output of GetHOCRText in the HOCRPage constructor above
+	for(HOCRItem* item : takeChildren()) {
+		if(!containsWords(item)) {
+			if(item->bbox().width() < 10 || item->bbox().height() < 10) {
+				delete item;
+				continue;
+			}
+			item->m_attrs["class"] = "ocr_graphic";
+			qDeleteAll(item->m_childItems);
+			item->m_childItems.clear();
+		}
+		item->m_index = m_childItems.size();
+		m_childItems.append(item);
+	}
+}
+
 QString HOCRPage::title() const {
 	return QString("%1 [%2]").arg(QFileInfo(m_sourceFile).fileName()).arg(m_pageNr);
 }
@@ -973,3 +1231,38 @@ void HOCRPage::convertSourcePath(const QString& basepath, bool absolute) {
 	}
 	m_titleAttrs["image"] = QString("'%1'").arg(m_sourceFile);
 }
+
+void HOCRPage::setSource(const QString& sourceFile, int pageNr, double angle, int resolution) {
+	m_sourceFile = sourceFile;
+	m_pageNr = pageNr;
+	m_angle = angle;
+	m_resolution = resolution;
+	m_titleAttrs["image"] = QString("'%1'").arg(sourceFile);
+	m_titleAttrs["ppageno"] = QString::number(pageNr);
+	m_titleAttrs["rot"] = QString::number(angle);
+	m_titleAttrs["res"] = QString::number(resolution);
+}
+
+void HOCRPage::adopt(int pageId, const QString& language, int index) {
+	m_pageId = pageId;
+	m_index = index;
+	m_attrs["id"] = QString("page_%1").arg(pageId);
+	m_idCounters.clear();
+	assignIds(this, language);
+}
+
+void HOCRPage::assignIds(HOCRItem* item, const QString& language) {
+	// Same ids and languages as for parsed pages, in document order
+	for(HOCRItem* child : item->m_childItems) {
+		QString idClass = child->itemClass().mid(child->itemClass().indexOf("_") + 1);
+		int counter = m_idCounters.value(idClass, 0) + 1;
+		m_idCounters[idClass] = counter;
+		child->m_attrs["id"] = QString("%1_%2_%3").arg(idClass).arg(m_pageId).arg(counter);
+		if(child->itemClass() == "ocrx_word") {
+			QString lang = child->m_attrs["lang"];
+			child->m_attrs["lang"] = lang.isEmpty() ? language : spellingLanguage(lang);
+		} else {
+			assignIds(child, language);
+		}
+	}
+}
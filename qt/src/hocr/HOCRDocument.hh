@@ -25,6 +25,9 @@
 #include <QRect>
 
 class QDomElement;
+namespace tesseract {
+class TessBaseAPI;
+}
 namespace QtSpell {
 class TextEditChecker;
 }
@@ -48,6 +51,8 @@ public:
 	QString toHTML() const;
 
 	QModelIndex addPage(const QDomElement& pageElement, bool cleanGraphics);
+	// Adds a page built from an engine result, takes ownership of the page
+	QModelIndex addPage(HOCRPage* page);
 	const HOCRPage* page(int i) const {
 		return m_pages.value(i);
 	}
@@ -64,6 +69,11 @@ public:
 	QModelIndex mergeItems(const QModelIndex& parent, int startRow, int endRow);
 	QModelIndex splitItem(const QModelIndex& item, int startRow, int endRow);
 	QModelIndex addItem(const QModelIndex& parent, const QDomElement& element);
+	// Replaces the children of the item, i.e. with those of the re-recognized region of the item. Returns false if none of them contain words.
+	bool replaceChildren(const QModelIndex& parent, const QList<QDomElement>& elements);
+	// Replaces the item by the given sibling items, i.e. a word by the words of its re-recognized region. Returns the first of them,
+	// or an invalid index if none of them contain words.
+	QModelIndex replaceItem(const QModelIndex& index, const QList<QDomElement>& elements);
 	bool removeItem(const QModelIndex& index);
 
 	QModelIndex nextIndex(const QModelIndex& current);
@@ -104,6 +114,7 @@ private:
 	void takeItem(HOCRItem* item);
 	void recursiveDataChanged(const QModelIndex& parent, const QVector<int>& roles, const QStringList& itemClasses = QStringList());
 	void recomputeBBoxes(HOCRItem* item);
+	QList<HOCRItem*> parseItems(HOCRItem* parentItem, const QList<QDomElement>& elements, const QString& language) const;
 	HOCRItem* mutableItemAtIndex(const QModelIndex& index) const {
 		return index.isValid() ? static_cast<HOCRItem*>(index.internalPointer()) : nullptr;
 	}
@@ -190,6 +201,8 @@ public:
 
 	static QMap<QString, QString> deserializeAttrGroup(const QString& string);
 	static QString serializeAttrGroup(const QMap<QString, QString>& attrs);
+	// Scales and then translates the bounding boxes of the element and its descendants, i.e. of a result recognized from a region of a page
+	static void mapBBoxes(QDomElement element, const QPoint& offset, double scale = 1.);
 	static QString trimmedWord(const QString& word, QString* prefix = nullptr, QString* suffix = nullptr);
 
 protected:
@@ -199,8 +212,8 @@ protected:
 	static QMap<QString, QString> s_langCache;
 
 	QString m_text;
-	bool m_bold;
-	bool m_italic;
+	bool m_bold = false;
+	bool m_italic = false;
 
 	QMap<QString, QString> m_attrs;
 	QMap<QString, QString> m_titleAttrs;
@@ -212,13 +225,22 @@ protected:
 
 	QRect m_bbox;
 
+	// Item built from an engine result, see HOCRPage
+	HOCRItem(const QString& itemClass, HOCRPage* page, HOCRItem* parent);
+	void setBBox(int x0, int y0, int x1, int y1);
+
 	bool parseChildren(const QDomElement& element, QString language);
+	static QString spellingLanguage(const QString& lang);
 };
 
 
 class HOCRPage : public HOCRItem {
 public:
 	HOCRPage(const QDomElement& element, int pageId, const QString& language, bool cleanGraphics, int index);
+	// Builds the page from the result of the last recognition of the engine, i.e. on a worker thread
+	// without serializing the result to hOCR and parsing it again. The page gets its id and the
+	// spelling languages of its words once it is added to a document.
+	HOCRPage(tesseract::TessBaseAPI& tess, int pageNr, const QSize& size);
 
 	const QString& sourceFile() const {
 		return m_sourceFile;
@@ -237,6 +259,7 @@ public:
 		return m_pageId;
 	}
 	QString title() const;
+	void setSource(const QString& sourceFile, int pageNr, double angle, int resolution);
 
 private:
 	friend class HOCRItem;
@@ -250,6 +273,8 @@ private:
 	int m_resolution;
 
 	void convertSourcePath(const QString& basepath, bool absolute);
+	void adopt(int pageId, const QString& language, int index);
+	void assignIds(HOCRItem* item, const QString& language);
 };
 
 
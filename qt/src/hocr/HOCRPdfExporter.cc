@@ -47,6 +47,7 @@
 
 #include "CCITTFax4Encoder.hh"
 #include "ConfigSettings.hh"
+#include "DisplayRenderer.hh"
 #include "Displayer.hh"
 #include "DisplayerToolHOCR.hh"
 #include "FileDialogs.hh"
@@ -522,85 +523,11 @@ bool HOCRPdfExporter::run(QString& filebasename) {
 	}
 
 	PDFSettings pdfSettings = getPdfSettings();
-	int outputDpi = ui.spinBoxDpi->value();
-	QString paperSize = ui.comboBoxPaperSize->itemData(ui.comboBoxPaperSize->currentIndex()).toString();
-
-	double pageWidth, pageHeight;
-	// Page dimensions are in points: 1 in = 72 pt
-	if(paperSize == "custom") {
-		pageWidth = ui.lineEditPaperWidth->text().toDouble() * 72.0;
-		pageHeight = ui.lineEditPaperHeight->text().toDouble() * 72.0;
-
-		PaperSize::Unit unit = static_cast<PaperSize::Unit>(ui.comboBoxPaperSizeUnit->itemData(ui.comboBoxPaperSizeUnit->currentIndex()).toInt());
-		if(unit == PaperSize::cm) {
-			pageWidth /= PaperSize::CMtoInch;
-			pageHeight /= PaperSize::CMtoInch;
-		}
-	} else if (paperSize != "source") {
-		auto inchSize = PaperSize::getSize(PaperSize::inch, paperSize.toStdString(), ui.toolButtonLandscape->isChecked());
-		pageWidth = inchSize.width * 72.0;
-		pageHeight = inchSize.height * 72.0;
-	}
-
 	MainWindow::ProgressMonitor monitor(pageCount);
 	MAIN->showProgress(&monitor);
 	QString errMsg;
 	bool success = Utils::busyTask([&] {
-		for(int i = 0; i < pageCount; ++i) {
-			if(monitor.cancelled()) {
-				errMsg = _("The operation was cancelled");
-				return false;
-			}
-			const HOCRPage* page = m_hocrdocument->page(i);
-			if(page->isEnabled()) {
-				QRect bbox = page->bbox();
-				QString sourceFile = page->sourceFile();
-				// If the source file is an image, its "resolution" is actually just the scale factor that was used for recognizing.
-				bool isImage = !sourceFile.endsWith(".pdf", Qt::CaseInsensitive) && !sourceFile.endsWith(".djvu", Qt::CaseInsensitive);
-				int sourceDpi = page->resolution();
-				int sourceScale = sourceDpi;
-				if(isImage) {
-					sourceDpi *= ui.spinBoxPaperSizeDpi->value() / 100;
-				}
-				// [pt] = 72 * [in]
-				// [in] = 1 / dpi * [px]
-				// => [pt] = 72 / dpi * [px]
-				double px2pt = (72.0 / sourceDpi);
-				double imgScale = double(outputDpi) / sourceDpi;
-				bool success = false;
-				if(isImage) {
-					QMetaObject::invokeMethod(this, "setSource", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, success), Q_ARG(QString, sourceFile), Q_ARG(int, page->pageNr()), Q_ARG(int, int(sourceScale * imgScale)), Q_ARG(double, page->angle()));
-				} else {
-					QMetaObject::invokeMethod(this, "setSource", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, success), Q_ARG(QString, sourceFile), Q_ARG(int, page->pageNr()), Q_ARG(int, outputDpi), Q_ARG(double, page->angle()));
-				}
-				if(success) {
-					if(paperSize == "source") {
-						pageWidth = bbox.width() * px2pt;
-						pageHeight = bbox.height() * px2pt;
-					}
-					double offsetX = 0.5 * (pageWidth - bbox.width() * px2pt);
-					double offsetY = 0.5 * (pageHeight - bbox.height() * px2pt);
-					if(!painter->createPage(pageWidth, pageHeight, offsetX, offsetY, errMsg)) {
-						return false;
-					}
-					printChildren(*painter, page, pdfSettings, px2pt, imgScale, double(sourceScale) / sourceDpi);
-					if(pdfSettings.overlay) {
-						QRect scaledRect(imgScale * bbox.left(), imgScale * bbox.top(), imgScale * bbox.width(), imgScale * bbox.height());
-						QRect printRect(bbox.left() * px2pt, bbox.top() * px2pt, bbox.width() * px2pt, bbox.height() * px2pt);
-						QImage selection;
-						QMetaObject::invokeMethod(this, "getSelection",  Qt::BlockingQueuedConnection, Q_RETURN_ARG(QImage, selection), Q_ARG(QRect, scaledRect));
-						painter->drawImage(printRect, selection, pdfSettings);
-					}
-					QMetaObject::invokeMethod(this, "setSource", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, success), Q_ARG(QString, page->sourceFile()), Q_ARG(int, page->pageNr()), Q_ARG(int, sourceScale), Q_ARG(double, page->angle()));
-					painter->finishPage();
-				} else {
-					errMsg = _("Failed to render page %1").arg(page->title());
-					return false;
-				}
-			}
-			monitor.increaseProgress();
-		}
-		return painter->finishDocument(errMsg);
+		return exportPages(*painter, pdfSettings, monitor, errMsg);
 	}, _("Exporting to PDF..."));
 	MAIN->hideProgress();
 
@@ -615,6 +542,85 @@ bool HOCRPdfExporter::run(QString& filebasename) {
 	return success;
 }
 
+bool HOCRPdfExporter::exportDocument(const QString& outname, QString& errMsg) {
+	QFont defaultFont = ui.checkBoxFontFamily->isChecked() ? ui.comboBoxFontFamily->currentFont() : ui.comboBoxFallbackFontFamily->currentFont();
+	defaultFont.setPointSize(ui.checkBoxFontSize->isChecked() ? ui.spinBoxFontSize->value() : 0);
+	PDFPainter* painter = createPoDoFoPrinter(outname, defaultFont, errMsg);
+	if(!painter) {
+		return false;
+	}
+	MainWindow::ProgressMonitor monitor(m_hocrdocument->pageCount());
+	bool success = exportPages(*painter, getPdfSettings(), monitor, errMsg);
+	delete painter;
+	return success;
+}
+
+bool HOCRPdfExporter::exportPages(PDFPainter& painter, const PDFSettings& pdfSettings, MainWindow::ProgressMonitor& monitor, QString& errMsg) {
+	// Unless exporting without displayer, the page sources are provided by the displayer on the GUI thread
+	Qt::ConnectionType connectionType = QThread::currentThread() == qApp->thread() ? Qt::DirectConnection : Qt::BlockingQueuedConnection;
+	int pageCount = m_hocrdocument->pageCount();
+	int outputDpi = pdfSettings.outputDpi;
+	double pageWidth = pdfSettings.pageWidth;
+	double pageHeight = pdfSettings.pageHeight;
+	for(int i = 0; i < pageCount; ++i) {
+		if(monitor.cancelled()) {
+			errMsg = _("The operation was cancelled");
+			return false;
+		}
+		const HOCRPage* page = m_hocrdocument->page(i);
+		if(page->isEnabled()) {
+			QRect bbox = page->bbox();
+			QString sourceFile = page->sourceFile();
+			// If the source file is an image, its "resolution" is actually just the scale factor that was used for recognizing.
+			bool isImage = !sourceFile.endsWith(".pdf", Qt::CaseInsensitive) && !sourceFile.endsWith(".djvu", Qt::CaseInsensitive);
+			int sourceDpi = page->resolution();
+			int sourceScale = sourceDpi;
+			if(isImage) {
+				sourceDpi *= pdfSettings.paperSizeDpi / 100;
+			}
+			// [pt] = 72 * [in]
+			// [in] = 1 / dpi * [px]
+			// => [pt] = 72 / dpi * [px]
+			double px2pt = (72.0 / sourceDpi);
+			double imgScale = double(outputDpi) / sourceDpi;
+			bool success = false;
+			if(isImage) {
+				QMetaObject::invokeMethod(this, "setSource", connectionType, Q_RETURN_ARG(bool, success), Q_ARG(QString, sourceFile), Q_ARG(int, page->pageNr()), Q_ARG(int, int(sourceScale * imgScale)), Q_ARG(double, page->angle()));
+			} else {
+				QMetaObject::invokeMethod(this, "setSource", connectionType, Q_RETURN_ARG(bool, success), Q_ARG(QString, sourceFile), Q_ARG(int, page->pageNr()), Q_ARG(int, outputDpi), Q_ARG(double, page->angle()));
+			}
+			if(success) {
+				if(pdfSettings.paperSize == "source") {
+					pageWidth = bbox.width() * px2pt;
+					pageHeight = bbox.height() * px2pt;
+				}
+				double offsetX = 0.5 * (pageWidth - bbox.width() * px2pt);
+				double offsetY = 0.5 * (pageHeight - bbox.height() * px2pt);
+				if(!painter.createPage(pageWidth, pageHeight, offsetX, offsetY, errMsg)) {
+					return false;
+				}
+				printChildren(painter, page, pdfSettings, px2pt, imgScale, double(sourceScale) / sourceDpi);
+				if(pdfSettings.overlay) {
+					QRect scaledRect(imgScale * bbox.left(), imgScale * bbox.top(), imgScale * bbox.width(), imgScale * bbox.height());
+					QRect printRect(bbox.left() * px2pt, bbox.top() * px2pt, bbox.width() * px2pt, bbox.height() * px2pt);
+					QImage selection;
+					QMetaObject::invokeMethod(this, "getSelection",  connectionType, Q_RETURN_ARG(QImage, selection), Q_ARG(QRect, scaledRect));
+					painter.drawImage(printRect, selection, pdfSettings);
+				}
+				if(m_displayerTool) {
+					QMetaObject::invokeMethod(this, "setSource", connectionType, Q_RETURN_ARG(bool, success), Q_ARG(QString, page->sourceFile()), Q_ARG(int, page->pageNr()), Q_ARG(int, sourceScale), Q_ARG(double, page->angle()));
+				}
+				painter.finishPage();
+			} else {
+				errMsg = _("Failed to render page %1").arg(page->title());
+				return false;
+			}
+		}
+		monitor.increaseProgress();
+	}
+	return painter.finishDocument(errMsg);
+}
+
 HOCRPdfExporter::PDFPainter* HOCRPdfExporter::createPoDoFoPrinter(const QString& filename, const QFont& defaultFont, QString& errMsg) {
 	PoDoFo::PdfStreamedDocument* document = nullptr;
 	PoDoFo::PdfFont* defaultPdfFont = nullptr;
@@ -688,6 +694,27 @@ HOCRPdfExporter::PDFSettings HOCRPdfExporter::getPdfSettings() const {
 	pdfSettings.overlay = ui.comboBoxOutputMode->currentIndex() == 1;
 	pdfSettings.detectedFontScaling = ui.spinFontScaling->value() / 100.;
 	pdfSettings.sanitizeHyphens = ui.checkBoxSanitizeHyphens->isChecked();
+	pdfSettings.outputDpi = ui.spinBoxDpi->value();
+	pdfSettings.paperSizeDpi = ui.spinBoxPaperSizeDpi->value();
+	pdfSettings.paperSize = ui.comboBoxPaperSize->itemData(ui.comboBoxPaperSize->currentIndex()).toString();
+	pdfSettings.pageWidth = 0;
+	pdfSettings.pageHeight = 0;
+
+	// Page dimensions are in points: 1 in = 72 pt
+	if(pdfSettings.paperSize == "custom") {
+		pdfSettings.pageWidth = ui.lineEditPaperWidth->text().toDouble() * 72.0;
+		pdfSettings.pageHeight = ui.lineEditPaperHeight->text().toDouble() * 72.0;
+
+		PaperSize::Unit unit = static_cast<PaperSize::Unit>(ui.comboBoxPaperSizeUnit->itemData(ui.comboBoxPaperSizeUnit->currentIndex()).toInt());
+		if(unit == PaperSize::cm) {
+			pdfSettings.pageWidth /= PaperSize::CMtoInch;
+			pdfSettings.pageHeight /= PaperSize::CMtoInch;
+		}
+	} else if (pdfSettings.paperSize != "source") {
+		auto inchSize = PaperSize::getSize(PaperSize::inch, pdfSettings.paperSize.toStdString(), ui.toolButtonLandscape->isChecked());
+		pdfSettings.pageWidth = inchSize.width * 72.0;
+		pdfSettings.pageHeight = inchSize.height * 72.0;
+	}
 	return pdfSettings;
 }
 
@@ -877,6 +904,14 @@ void HOCRPdfExporter::imageCompressionChanged() {
 }
 
 bool HOCRPdfExporter::setSource(const QString& sourceFile, int page, int dpi, double angle) {
+	if(!m_displayerTool) {
+		if(!m_renderer || m_renderer->getFilename() != sourceFile) {
+			m_renderer.reset(DisplayRenderer::create(sourceFile, QByteArray()));
+		}
+		QImage image = m_renderer->render(page, dpi);
+		m_sourceImage = image.isNull() ? QImage() : Displayer::getImage(image, angle, Displayer::getSceneBoundingRect(image.size(), angle));
+		return !m_sourceImage.isNull();
+	}
 	if(MAIN->getSourceManager()->addSource(sourceFile, true)) {
 		MAIN->getDisplayer()->setup(&page, &dpi, &angle);
 		return true;
@@ -886,6 +921,9 @@ bool HOCRPdfExporter::setSource(const QString& sourceFile, int page, int dpi, do
 }
 
 QImage HOCRPdfExporter::getSelection(const QRect& bbox) {
+	if(!m_displayerTool) {
+		return m_sourceImage.copy(bbox);
+	}
 	return m_displayerTool->getSelection(bbox);
 }
 
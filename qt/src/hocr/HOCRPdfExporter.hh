@@ -22,8 +22,11 @@
 
 #include <QImage>
 #include <QVector>
+#include <memory>
 
 #include "common.hh"
+#include "DisplayRenderer.hh"
+#include "MainWindow.hh"
 #include "ui_PdfExportDialog.h"
 
 class QFontDialog;
@@ -40,6 +43,9 @@ class HOCRPdfExporter: public QDialog {
 public:
 	HOCRPdfExporter(const HOCRDocument* hocrdocument, const HOCRPage* previewPage, DisplayerToolHOCR* displayerTool, QWidget* parent = 0);
 	bool run(QString& filebasename);
+	// Exports with the stored settings through the PoDoFo backend, without user interaction.
+	// If no displayer tool is specified, the page sources are rendered directly.
+	bool exportDocument(const QString& outname, QString& errMsg);
 
 private:
 	enum PDFBackend { BackendPoDoFo, BackendQPrinter};
@@ -56,6 +62,11 @@ private:
 		bool overlay;
 		double detectedFontScaling;
 		bool sanitizeHyphens;
+		int outputDpi;
+		int paperSizeDpi;
+		QString paperSize;
+		double pageWidth;
+		double pageHeight;
 	};
 
 	class PDFPainter {
@@ -104,8 +115,11 @@ private:
 	const HOCRDocument* m_hocrdocument;
 	const HOCRPage* m_previewPage;
 	DisplayerToolHOCR* m_displayerTool;
+	std::unique_ptr<DisplayRenderer> m_renderer;
+	QImage m_sourceImage;
 
 	PDFSettings getPdfSettings() const;
+	bool exportPages(PDFPainter& painter, const PDFSettings& pdfSettings, MainWindow::ProgressMonitor& monitor, QString& errMsg);
 	PDFPainter* createPoDoFoPrinter(const QString& filename, const QFont& defaultFont, QString& errMsg);
 	void printChildren(PDFPainter& painter, const HOCRItem* item, const PDFSettings& pdfSettings, double px2pu, double imgScale = 1., double fontScale = 1.);
 
@@ -26,6 +26,7 @@
 #include <QShortcut>
 #include <QStyledItemDelegate>
 #include <QMessageBox>
+#include <QMutexLocker>
 #include <QPointer>
 #include <QSyntaxHighlighter>
 #include <algorithm>
@@ -38,6 +39,7 @@
 
 #include "ConfigSettings.hh"
 #include "DisplayerToolHOCR.hh"
+#include "EngineCache.hh"
 #include "FileDialogs.hh"
 #include "HOCRDocument.hh"
 #include "HOCROdtExporter.hh"
@@ -45,10 +47,13 @@
 #include "HOCRTextExporter.hh"
 #include "MainWindow.hh"
 #include "OutputEditorHOCR.hh"
+#include "PerformanceLog.hh"
 #include "Recognizer.hh"
 #include "SourceManager.hh"
 #include "Utils.hh"
 
+Q_DECLARE_METATYPE(std::shared_ptr<OutputEditor::Result>)
+
 
 class OutputEditorHOCR::HTMLHighlighter : public QSyntaxHighlighter {
 public:
@@ -197,9 +202,32 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+class OutputEditorHOCR::BuiltPage : public OutputEditor::Result {
+public:
+	BuiltPage(HOCRPage* page) : m_page(page) {}
+	~BuiltPage() {
+		delete m_page;
+	}
+	QString toString() const override {
+		return m_page->toHtml();
+	}
+	HOCRPage* takePage() {
+		HOCRPage* page = m_page;
+		m_page = nullptr;
+		return page;
+	}
+
+private:
+	HOCRPage* m_page;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 OutputEditorHOCR::OutputEditorHOCR(DisplayerToolHOCR* tool) {
 	static int reg = qRegisterMetaType<QList<QRect>>("QList<QRect>");
 	Q_UNUSED(reg);
+	static int regPage = qRegisterMetaType<std::shared_ptr<OutputEditor::Result>>("std::shared_ptr<OutputEditor::Result>");
+	Q_UNUSED(regPage);
 
 	m_tool = tool;
 	m_widget = new QWidget;
@@ -295,16 +323,21 @@ void OutputEditorHOCR::setModified() {
 	m_modified = true;
 }
 
-OutputEditorHOCR::ReadSessionData* OutputEditorHOCR::initRead(tesseract::TessBaseAPI& tess) {
-	tess.SetPageSegMode(tesseract::PSM_AUTO_ONLY);
+OutputEditorHOCR::ReadSessionData* OutputEditorHOCR::initRead() {
 	return new HOCRReadSessionData;
 }
 
-void OutputEditorHOCR::read(tesseract::TessBaseAPI& tess, ReadSessionData* data) {
-	tess.SetVariable("hocr_font_info", "true");
-	char* text = tess.GetHOCRText(data->page);
-	QMetaObject::invokeMethod(this, "addPage", Qt::QueuedConnection, Q_ARG(QString, QString::fromUtf8(text)), Q_ARG(ReadSessionData, *data));
-	delete[] text;
+std::shared_ptr<OutputEditor::Result> OutputEditorHOCR::buildResult(tesseract::TessBaseAPI& tess, int page, const QSize& size) const {
+	return std::make_shared<BuiltPage>(new HOCRPage(tess, page, size));
+}
+
+void OutputEditorHOCR::readResult(const QString& result, ReadSessionData* data) {
+	QMetaObject::invokeMethod(this, "addPage", Qt::QueuedConnection, Q_ARG(QString, result), Q_ARG(ReadSessionData, *data));
+}
+
+void OutputEditorHOCR::readBuiltResult(const std::shared_ptr<Result>& result, ReadSessionData* data) {
+	// The result keeps owning the page until it is added, so that it is freed if the editor is destroyed before
+	QMetaObject::invokeMethod(this, "addBuiltPage", Qt::QueuedConnection, Q_ARG(std::shared_ptr<OutputEditor::Result>, result), Q_ARG(ReadSessionData, *data));
 }
 
 void OutputEditorHOCR::readError(const QString& errorMsg, ReadSessionData* data) {
@@ -321,6 +354,8 @@ void OutputEditorHOCR::finalizeRead(ReadSessionData* data) {
 }
 
 void OutputEditorHOCR::addPage(const QString& hocrText, ReadSessionData data) {
+	PerformanceLog* performanceLog = MAIN->getPerformanceLog();
+	PerformanceLog::Timer timer;
 	QDomDocument doc;
 	doc.setContent(hocrText);
 
@@ -331,10 +366,26 @@ void OutputEditorHOCR::addPage(const QString& hocrText, ReadSessionData data) {
 	attrs["rot"] = QString::number(data.angle);
 	attrs["res"] = QString::number(data.resolution);
 	pageDiv.setAttribute("title", HOCRItem::serializeAttrGroup(attrs));
+	performanceLog->addTime(data.timingId, PerformanceLog::StageParse, timer);
 
+	timer.restart();
 	QModelIndex index = m_document->addPage(pageDiv, true);
 
 	expandCollapseChildren(index, true);
+	performanceLog->addTime(data.timingId, PerformanceLog::StageInsert, timer);
+	MAIN->setOutputPaneVisible(true);
+	m_modified = true;
+}
+
+void OutputEditorHOCR::addBuiltPage(std::shared_ptr<OutputEditor::Result> result, ReadSessionData data) {
+	// The page was built by the recognition worker, only the source and the ids are still to be assigned
+	PerformanceLog::Timer timer;
+	HOCRPage* page = static_cast<BuiltPage*>(result.get())->takePage();
+	page->setSource(data.file, data.page, data.angle, data.resolution);
+	QModelIndex index = m_document->addPage(page);
+
+	expandCollapseChildren(index, true);
+	MAIN->getPerformanceLog()->addTime(data.timingId, PerformanceLog::StageInsert, timer);
 	MAIN->setOutputPaneVisible(true);
 	m_modified = true;
 }
@@ -406,6 +457,85 @@ bool OutputEditorHOCR::showPage(const HOCRPage* page) {
 	return page && MAIN->getSourceManager()->addSource(page->sourceFile(), true) && MAIN->getDisplayer()->setup(&page->pageNr(), &page->resolution(), &page->angle());
 }
 
+static void collectElements(const QDomElement& parent, const QStringList& itemClasses, QList<QDomElement>& elements) {
+	for(QDomElement child = parent.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+		if(itemClasses.contains(child.attribute("class"))) {
+			elements.append(child);
+		} else {
+			collectElements(child, itemClasses, elements);
+		}
+	}
+}
+
+bool OutputEditorHOCR::recognizeRegion(const HOCRPage* page, const QRect& bbox, int psm, const QStringList& itemClasses, QDomDocument& doc, QList<QDomElement>& elements) {
+	// The region is cropped from the page as displayed and recognized on a cached engine, which keeps the correction loop interactive
+	if(!showPage(page)) {
+		return false;
+	}
+	QString result;
+	Recognizer::RegionStatus status = MAIN->getRecognizer()->recognizeRegion(m_tool->getSelection(bbox), page->resolution(), psm, page->pageNr(), result);
+	if(status == Recognizer::RegionStatus::InitFailed) {
+		QMessageBox::critical(MAIN, _("Recognition errors occurred"), _("Failed to initialize tesseract"));
+		return false;
+	} else if(status == Recognizer::RegionStatus::Cancelled) {
+		return false;
+	}
+	doc.setContent(result);
+	collectElements(doc.documentElement(), itemClasses, elements);
+	for(const QDomElement& element : elements) {
+		HOCRItem::mapBBoxes(element, bbox.topLeft());
+	}
+	return true;
+}
+
+bool OutputEditorHOCR::recognizeItem(const QModelIndex& index) {
+	const HOCRItem* item = m_document->itemAtIndex(index);
+	if(!item) {
+		return false;
+	}
+	QString itemClass = item->itemClass();
+	QDomDocument doc;
+	QList<QDomElement> elements;
+	if(itemClass == "ocrx_word") {
+		if(!recognizeRegion(item->page(), item->bbox(), tesseract::PSM_SINGLE_WORD, {"ocrx_word"}, doc, elements)) {
+			return false;
+		}
+		// The region may turn out to contain several words, each of which gets its own item
+		QModelIndex first = m_document->replaceItem(index, elements);
+		if(!first.isValid()) {
+			MAIN->addNotification(_("No text recognized"), _("No text was recognized in the region of the item, it was left unchanged."), {});
+			return false;
+		}
+		ui.treeViewHOCR->selectionModel()->setCurrentIndex(first, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+		return true;
+	}
+	// Containers are recognized as a whole, their children are replaced by the corresponding items of the result
+	int psm;
+	QStringList childClasses;
+	if(itemClass == "ocr_carea") {
+		psm = tesseract::PSM_SINGLE_BLOCK;
+		childClasses = QStringList {"ocr_par"};
+	} else if(itemClass == "ocr_par") {
+		psm = tesseract::PSM_SINGLE_BLOCK;
+		childClasses = QStringList {"ocr_line", "ocr_caption", "ocr_textfloat", "ocr_header"};
+	} else if(itemClass == "ocr_line") {
+		psm = tesseract::PSM_SINGLE_LINE;
+		childClasses = QStringList {"ocrx_word"};
+	} else {
+		return false;
+	}
+	if(!recognizeRegion(item->page(), item->bbox(), psm, childClasses, doc, elements)) {
+		return false;
+	}
+	if(!m_document->replaceChildren(index, elements)) {
+		MAIN->addNotification(_("No text recognized"), _("No text was recognized in the region of the item, it was left unchanged."), {});
+		return false;
+	}
+	expandCollapseChildren(index, true);
+	showItemProperties(index);
+	return true;
+}
+
 void OutputEditorHOCR::showItemProperties(const QModelIndex& index, const QModelIndex& prev) {
 	m_tool->setAction(DisplayerToolHOCR::ACTION_NONE);
 	const HOCRItem* prevItem = m_document->itemAtIndex(prev);
@@ -577,7 +707,16 @@ void OutputEditorHOCR::bboxDrawn(const QRect& bbox, int action) {
 		titleAttrs["baseline"] = propLineBaseline.size() == 1 ? *propLineBaseline.begin() : QString("0 0");
 		newElement.setAttribute("title", HOCRItem::serializeAttrGroup(titleAttrs));
 	} else if(action == DisplayerToolHOCR::ACTION_DRAW_WORD_RECT) {
-		QString text = QInputDialog::getText(m_widget, _("Add Word"), _("Enter word:"));
+		// Suggest the text recognized in the drawn region
+		QDomDocument wordDoc;
+		QList<QDomElement> words;
+		QStringList suggestion;
+		if(recognizeRegion(currentItem->page(), bbox, tesseract::PSM_SINGLE_WORD, {"ocrx_word"}, wordDoc, words)) {
+			for(const QDomElement& word : words) {
+				suggestion.append(word.text());
+			}
+		}
+		QString text = QInputDialog::getText(m_widget, _("Add Word"), _("Enter word:"), QLineEdit::Normal, suggestion.join(" "));
 		if(text.isEmpty()) {
 			return;
 		}
@@ -602,6 +741,10 @@ void OutputEditorHOCR::bboxDrawn(const QRect& bbox, int action) {
 	}
 	QModelIndex index = m_document->addItem(current, newElement);
 	if(index.isValid()) {
+		// New text regions are filled with the text recognized in them
+		if(action == DisplayerToolHOCR::ACTION_DRAW_CAREA_RECT || action == DisplayerToolHOCR::ACTION_DRAW_PAR_RECT || action == DisplayerToolHOCR::ACTION_DRAW_LINE_RECT) {
+			recognizeItem(index);
+		}
 		ui.treeViewHOCR->selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
 	}
 }
@@ -682,6 +825,7 @@ void OutputEditorHOCR::showTreeWidgetContextMenu(const QPoint& point) {
 	QAction* actionAddLine = nullptr;
 	QAction* actionAddWord = nullptr;
 	QAction* actionSplit = nullptr;
+	QAction* actionRecognize = nullptr;
 	QAction* actionDictAddWord = nullptr;
 	QAction* actionDictIgnoreWord = nullptr;
 	QList<QAction*> setTextActions;
@@ -724,6 +868,9 @@ void OutputEditorHOCR::showTreeWidgetContextMenu(const QPoint& point) {
 	if(itemClass == "ocr_par" || itemClass == "ocr_line" || itemClass == "ocrx_word") {
 		actionSplit = menu.addAction(_("Split from parent"));
 	}
+	if(itemClass == "ocr_carea" || itemClass == "ocr_par" || itemClass == "ocr_line" || itemClass == "ocrx_word") {
+		actionRecognize = menu.addAction(_("Recognize again"));
+	}
 	actionRemove = menu.addAction(_("Remove"));
 	actionRemove->setShortcut(QKeySequence(Qt::Key_Delete));
 	if(m_document->rowCount(index) > 0) {
@@ -757,6 +904,8 @@ void OutputEditorHOCR::showTreeWidgetContextMenu(const QPoint& point) {
 		QModelIndex newIndex = m_document->splitItem(index.parent(), index.row(), index.row());
 		ui.treeViewHOCR->selectionModel()->setCurrentIndex(newIndex, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
 		expandCollapseChildren(newIndex, true);
+	} else if(clickedAction == actionRecognize) {
+		recognizeItem(index);
 	} else if(clickedAction == actionRemove) {
 		m_document->removeItem(ui.treeViewHOCR->selectionModel()->currentIndex());
 	} else if(clickedAction == actionExpand) {
@@ -839,10 +988,12 @@ bool OutputEditorHOCR::save(const QString& filename) {
 		QMessageBox::critical(MAIN, _("Failed to save output"), _("Check that you have writing permissions in the selected folder."));
 		return false;
 	}
+	QMutexLocker locker(&EngineCache::initMutex());
 	QByteArray current = setlocale(LC_ALL, NULL);
 	setlocale(LC_ALL, "C");
 	tesseract::TessBaseAPI tess;
 	setlocale(LC_ALL, current.constData());
+	locker.unlock();
 	QString header = QString(
 	                     "<!DOCTYPE html>\n"
 	                     "<html>\n"
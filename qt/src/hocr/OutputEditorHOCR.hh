@@ -29,6 +29,8 @@ class DisplayerToolHOCR;
 class HOCRDocument;
 class HOCRPage;
 class HOCRItem;
+class QDomDocument;
+class QDomElement;
 class QGraphicsPixmapItem;
 
 class OutputEditorHOCR : public OutputEditor {
@@ -40,8 +42,13 @@ public:
 	QWidget* getUI() override {
 		return m_widget;
 	}
-	ReadSessionData* initRead(tesseract::TessBaseAPI& tess) override;
-	void read(tesseract::TessBaseAPI& tess, ReadSessionData* data) override;
+	ReadSessionData* initRead() override;
+	ResultFormat resultFormat() const override {
+		return ResultFormat::HOCR;
+	}
+	std::shared_ptr<Result> buildResult(tesseract::TessBaseAPI& tess, int page, const QSize& size) const override;
+	void readResult(const QString& result, ReadSessionData* data) override;
+	void readBuiltResult(const std::shared_ptr<Result>& result, ReadSessionData* data) override;
 	void readError(const QString& errorMsg, ReadSessionData* data) override;
 	void finalizeRead(ReadSessionData* data) override;
 	bool getModified() const override {
@@ -61,6 +68,7 @@ public slots:
 
 private:
 	class HTMLHighlighter;
+	class BuiltPage;
 
 	struct HOCRReadSessionData : ReadSessionData {
 		QStringList errors;
@@ -84,11 +92,14 @@ private:
 	void navigateNextPrev(bool next);
 	bool findReplaceInItem(const QModelIndex& index, const QString& searchstr, const QString& replacestr, bool matchCase, bool backwards, bool replace, bool& currentSelectionMatchesSearch);
 	bool showPage(const HOCRPage* page);
+	bool recognizeRegion(const HOCRPage* page, const QRect& bbox, int psm, const QStringList& itemClasses, QDomDocument& doc, QList<QDomElement>& elements);
+	bool recognizeItem(const QModelIndex& index);
 	void drawPreview(QPainter& painter, const HOCRItem* item);
 
 private slots:
 	void bboxDrawn(const QRect& bbox, int action);
 	void addPage(const QString& hocrText, ReadSessionData data);
+	void addBuiltPage(std::shared_ptr<OutputEditor::Result> result, ReadSessionData data);
 	void expandItemClass() {
 		expandCollapseItemClass(true);
 	}
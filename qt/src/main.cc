@@ -26,11 +26,19 @@
 #include <libintl.h>
 #include <cstring>
 
+#include "BatchProcessor.hh"
 #include "MainWindow.hh"
 #include "Config.hh"
 #include "CrashHandler.hh"
+#include "WorkerProcess.hh"
 
 int main (int argc, char* argv[]) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+	// Batch processing and recognition workers must not require a display server
+	if((BatchProcessor::isBatchCommand(argc, argv) || WorkerProcess::isWorkerCommand(argc, argv)) && qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+#endif
 	QApplication app(argc, argv);
 
 	QDir dataDir = QDir(QString("%1/../share/").arg(QApplication::applicationDirPath()));
@@ -66,7 +74,12 @@ int main (int argc, char* argv[]) {
 	textdomain(GETTEXT_PACKAGE);
 
 	QWidget* window;
-	if(argc >= 3 && std::strcmp("crashhandle", argv[1]) == 0) {
+	if(BatchProcessor::isBatchCommand(argc, argv)) {
+		QStringList args = QApplication::arguments().mid(2);
+		return BatchProcessor().run(args);
+	} else if(WorkerProcess::isWorkerCommand(argc, argv)) {
+		return WorkerProcess::serve();
+	} else if(argc >= 3 && std::strcmp("crashhandle", argv[1]) == 0) {
 		int pid = std::atoi(argv[2]);
 		int tesseractCrash = std::atoi(argv[3]);
 		QString savefile = argc >= 5 ? argv[4] : "";